@@ -0,0 +1,40 @@
+# Find Brotli
+# ~~~~~~~~~~~
+#
+# CMake module to search for the Brotli compression library
+#
+# If it's found it sets BROTLI_FOUND to TRUE
+# and following variables are set:
+#    BROTLI_INCLUDE_DIR
+#    BROTLI_LIBRARY
+
+FIND_PATH(BROTLI_INCLUDE_DIR brotli/encode.h
+  "$ENV{LIB_DIR}/include"
+  NO_DEFAULT_PATH
+  )
+FIND_PATH(BROTLI_INCLUDE_DIR brotli/encode.h)
+
+FIND_LIBRARY(BROTLI_LIBRARY NAMES brotlienc PATHS
+  "$ENV{LIB_DIR}/lib"
+  NO_DEFAULT_PATH
+  )
+FIND_LIBRARY(BROTLI_LIBRARY NAMES brotlienc)
+
+IF (BROTLI_INCLUDE_DIR AND BROTLI_LIBRARY)
+   SET(BROTLI_FOUND TRUE)
+ENDIF (BROTLI_INCLUDE_DIR AND BROTLI_LIBRARY)
+
+
+IF (BROTLI_FOUND)
+
+   IF (NOT BROTLI_FIND_QUIETLY)
+      MESSAGE(STATUS "Found Brotli: ${BROTLI_LIBRARY}")
+   ENDIF (NOT BROTLI_FIND_QUIETLY)
+
+ELSE (BROTLI_FOUND)
+
+   IF (BROTLI_FIND_REQUIRED)
+      MESSAGE(FATAL_ERROR "Could not find Brotli")
+   ENDIF (BROTLI_FIND_REQUIRED)
+
+ENDIF (BROTLI_FOUND)
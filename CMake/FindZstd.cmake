@@ -0,0 +1,40 @@
+# Find Zstd
+# ~~~~~~~~~~~
+#
+# CMake module to search for the Zstd compression library
+#
+# If it's found it sets ZSTD_FOUND to TRUE
+# and following variables are set:
+#    ZSTD_INCLUDE_DIR
+#    ZSTD_LIBRARY
+
+FIND_PATH(ZSTD_INCLUDE_DIR zstd.h
+  "$ENV{LIB_DIR}/include"
+  NO_DEFAULT_PATH
+  )
+FIND_PATH(ZSTD_INCLUDE_DIR zstd.h)
+
+FIND_LIBRARY(ZSTD_LIBRARY NAMES zstd PATHS
+  "$ENV{LIB_DIR}/lib"
+  NO_DEFAULT_PATH
+  )
+FIND_LIBRARY(ZSTD_LIBRARY NAMES zstd)
+
+IF (ZSTD_INCLUDE_DIR AND ZSTD_LIBRARY)
+   SET(ZSTD_FOUND TRUE)
+ENDIF (ZSTD_INCLUDE_DIR AND ZSTD_LIBRARY)
+
+
+IF (ZSTD_FOUND)
+
+   IF (NOT ZSTD_FIND_QUIETLY)
+      MESSAGE(STATUS "Found Zstd: ${ZSTD_LIBRARY}")
+   ENDIF (NOT ZSTD_FIND_QUIETLY)
+
+ELSE (ZSTD_FOUND)
+
+   IF (ZSTD_FIND_REQUIRED)
+      MESSAGE(FATAL_ERROR "Could not find Zstd")
+   ENDIF (ZSTD_FIND_REQUIRED)
+
+ENDIF (ZSTD_FOUND)
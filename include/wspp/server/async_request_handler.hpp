@@ -0,0 +1,31 @@
+#ifndef __SERVER_ASYNC_REQUEST_HANDLER_HPP__
+#define __SERVER_ASYNC_REQUEST_HANDLER_HPP__
+
+#include <boost/asio.hpp>
+#include <boost/asio/spawn.hpp>
+
+#include <wspp/server/request_handler.hpp>
+
+namespace wspp {
+namespace server {
+// A handler that runs in a stackful coroutine (see boost::asio::spawn) on the I/O thread of the connection.
+// Instead of blocking, it waits for asynchronous operations started on the given io_service by passing yield
+// as their completion handler, e.g.
+//
+//     boost::asio::steady_timer timer(io, std::chrono::seconds(1));
+//     timer.async_wait(yield);
+//
+// The thread then serves other connections until the operation completes and the handler resumes. The response is
+// sent when handle returns. Such handlers run on the I/O threads even if the server has a worker pool.
+class AsyncRequestHandler: public RequestHandler {
+public:
+    explicit AsyncRequestHandler() = default;
+
+    virtual void handle(const Request &req, Response &resp, boost::asio::io_service &io, boost::asio::yield_context yield) = 0;
+
+    // Runs the asynchronous version to completion on a private io_service, for callers that cannot yield.
+    void handle(const Request &req, Response &resp) override;
+};
+} // namespace server
+} // namespace wspp
+#endif
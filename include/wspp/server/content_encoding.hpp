@@ -0,0 +1,76 @@
+#ifndef __SERVER_CONTENT_ENCODING_HPP__
+#define __SERVER_CONTENT_ENCODING_HPP__
+
+#include <string>
+#include <vector>
+#include <memory>
+#include <functional>
+
+#include <boost/noncopyable.hpp>
+
+namespace wspp {
+namespace server {
+
+// A content coding of reply bodies such as gzip. gzip is always available, br (brotli) and zstd when the library
+// is built with them (HAS_BROTLI_ENCODING, HAS_ZSTD_ENCODING). Other codings may be registered with
+// ContentEncodings::instance().add() at startup.
+class ContentEncoding: private boost::noncopyable {
+public:
+    // trade-off of compression speed against ratio, mapped to the levels of each coding
+    enum Quality { fastest, balanced, best };
+
+    // compresses a single body piece by piece (e.g. a streamed reply)
+    class Encoder {
+    public:
+        virtual ~Encoder() = default;
+
+        // compress the next piece of the body appending the output to out, finish ends the body
+        virtual void compress(const char *data, std::size_t size, std::string &out, bool finish) = 0;
+    };
+
+    ContentEncoding(const std::string &name, const std::string &extension): name_(name), extension_(extension) {}
+    virtual ~ContentEncoding() = default;
+
+    // the token of the coding in the Accept-Encoding and Content-Encoding headers
+    const std::string &name() const { return name_; }
+    // the extension of precompressed copies of files (e.g. style.css.gz)
+    const std::string &extension() const { return extension_; }
+
+    virtual std::unique_ptr<Encoder> encoder(Quality quality) const = 0;
+
+    // compress a whole body replacing the contents of out, whose memory is reused
+    virtual void compress(const char *data, std::size_t size, std::string &out, Quality quality) const;
+
+private:
+    std::string name_, extension_;
+};
+
+// The content codings supported by the server in the order of preference
+class ContentEncodings: private boost::noncopyable {
+public:
+    static ContentEncodings &instance();
+
+    // add a coding, preferred over the codings added before it
+    void add(const std::shared_ptr<ContentEncoding> &encoding);
+
+    // the coding with the given name or null
+    const ContentEncoding *find(const std::string &name) const;
+
+    // The preferred coding among those the Accept-Encoding header rates highest, or null if none is acceptable
+    // (the body should be sent as it is). Codings with q=0 are not acceptable and * stands for unlisted codings.
+    // If given, only the codings for which available returns true are considered (e.g. those of precompressed files).
+    const ContentEncoding *negotiate(const std::string &accept_encoding,
+                                     const std::function<bool (const ContentEncoding &)> &available = nullptr) const;
+
+    const std::vector<std::shared_ptr<ContentEncoding>> &all() const { return encodings_; }
+
+private:
+    ContentEncodings();
+
+    // from the most to the least preferred
+    std::vector<std::shared_ptr<ContentEncoding>> encodings_;
+};
+
+} // namespace server
+} // namespace wspp
+#endif
@@ -0,0 +1,66 @@
+#ifndef HTTP_SERVER_ADMISSION_CONTROL_HPP
+#define HTTP_SERVER_ADMISSION_CONTROL_HPP
+
+#include <boost/noncopyable.hpp>
+
+#include <atomic>
+#include <cstdint>
+#include <cstddef>
+
+namespace wspp {
+namespace server {
+
+// Snapshot of the load of the server and of the work it turned down, for monitoring (see Server::stats)
+struct ServerStats {
+    // connections currently open
+    std::size_t open_connections_ = 0;
+    // requests currently handled or waiting for a worker
+    std::size_t in_flight_requests_ = 0;
+    // requests waiting for a worker
+    std::size_t queued_requests_ = 0;
+
+    // totals since the server started
+    uint64_t accepted_connections_ = 0;
+    // connections closed at once because of the connection limits
+    uint64_t rejected_connections_ = 0;
+    uint64_t requests_ = 0;
+    // requests answered with 503 because of the in-flight limit or a full worker queue
+    uint64_t rejected_requests_ = 0;
+    // requests answered with 503 because they waited too long for a worker
+    uint64_t dropped_requests_ = 0;
+};
+
+namespace detail {
+
+// Counts open connections and requests in flight so that the server refuses new work (with a quick 503) when it has
+// too much of it, instead of piling up connections and queued requests until it runs out of memory.
+class AdmissionControl: private boost::noncopyable {
+public:
+    AdmissionControl();
+
+    // Register a new connection unless max_connections (if not 0) are already open.
+    bool acquireConnection(std::size_t max_connections);
+    void releaseConnection();
+
+    // a connection turned down by another limit (e.g. per address)
+    void connectionRejected() { ++rejected_connections_; }
+
+    // Register a request to be handled unless max_in_flight (if not 0) are already in flight.
+    bool acquireRequest(std::size_t max_in_flight);
+    void releaseRequest();
+
+    // a registered request that could not be queued for a worker, or that waited too long for one
+    void requestRejected() { ++rejected_requests_; }
+    void requestDropped() { ++dropped_requests_; }
+
+    ServerStats stats() const;
+
+private:
+    std::atomic<std::size_t> connections_, in_flight_;
+    std::atomic<uint64_t> accepted_connections_, rejected_connections_, requests_, rejected_requests_, dropped_requests_;
+};
+
+} // namespace detail
+} // namespace server
+} // namespace wspp
+#endif
@@ -0,0 +1,67 @@
+#ifndef __SERVER_ASSET_CACHE_HPP__
+#define __SERVER_ASSET_CACHE_HPP__
+
+#include <string>
+#include <memory>
+#include <chrono>
+#include <map>
+
+#include <boost/noncopyable.hpp>
+
+#include <wspp/server/detail/file_body.hpp>
+#include <wspp/server/detail/lru_cache.hpp>
+
+namespace wspp {
+namespace server {
+namespace detail {
+
+// Contents of static files kept in memory together with their compressed encodings, so that serving a popular asset
+// costs a lookup rather than opening, reading and compressing the file. Precompressed copies next to a file (e.g.
+// style.css.br, see ContentEncoding::extension) are used instead of compressing it when they are not older than the
+// file. Files are checked for modification at most once per ttl. The least recently used files are evicted when the
+// cache exceeds its memory budget.
+class AssetCache: private boost::noncopyable {
+public:
+    struct Asset {
+        // the contents of the file
+        std::shared_ptr<FileBody> body_;
+        // the encodings of the contents that pay off by name of the content coding
+        std::map<std::string, std::shared_ptr<FileBody>> encoded_;
+        // encoding of the file itself (e.g. gzip for .gz files) or empty
+        std::string encoding_;
+        std::string mime_;
+
+        // The encoded contents the client with the given Accept-Encoding header prefers or null, setting encoding
+        std::shared_ptr<FileBody> select(const std::string &accept_encoding, std::string &encoding) const;
+    };
+
+    // files larger than max_file_size are not cached
+    AssetCache(std::size_t max_size, std::chrono::seconds ttl, std::size_t max_file_size);
+
+    // The asset of the file at path, loaded if not cached or modified. Returns null if the file does not exist or
+    // is too large to be cached. May be called from any thread.
+    std::shared_ptr<const Asset> get(const std::string &path);
+
+    // total size of the cached contents
+    std::size_t size() const;
+
+private:
+    struct Entry {
+        std::shared_ptr<const Asset> asset_;
+        // when the file was last checked for modification
+        std::chrono::steady_clock::time_point checked_;
+    };
+
+    std::shared_ptr<const Asset> load(const std::string &path);
+    static std::size_t cost(const Asset &asset);
+
+    std::size_t max_file_size_;
+    std::chrono::seconds ttl_;
+
+    LruCache<std::string, Entry> entries_;
+};
+
+} // namespace detail
+} // namespace server
+} // namespace wspp
+#endif
@@ -12,11 +12,16 @@
 #define HTTP_SERVER_CONNECTION_HPP
 
 #include <boost/asio.hpp>
+#include <boost/asio/steady_timer.hpp>
+#include <boost/asio/spawn.hpp>
 #include <boost/array.hpp>
 #include <boost/noncopyable.hpp>
 #include <boost/shared_ptr.hpp>
 #include <boost/enable_shared_from_this.hpp>
 
+#include <sstream>
+#include <cstdio>
+
 #include <wspp/server/response.hpp>
 #include <wspp/server/request.hpp>
 #include <wspp/util/logger.hpp>
@@ -26,109 +31,649 @@
 #include <wspp/server/exceptions.hpp>
 #include <wspp/server/detail/request_parser.hpp>
 #include <wspp/server/detail/connection_manager.hpp>
+#include <wspp/server/detail/file_body.hpp>
+#include <wspp/server/detail/handler_allocator.hpp>
+#include <wspp/server/detail/worker_pool.hpp>
+#include <wspp/server/detail/admission_control.hpp>
+#include <wspp/server/metrics.hpp>
+
+#ifdef __linux__
+#include <sys/sendfile.h>
+#endif
 
 namespace wspp {
 namespace server {
 class ConnectionManager;
 class Server;
+namespace detail {
+class ConnectionPool;
+}
 
 using util::Logger;
+using detail::FileBody;
+using detail::HandlerMemory;
+using detail::makeCustomAllocHandler;
+
+// Metrics recorded by the connections (see Server::setMetrics)
+struct ConnectionMetrics {
+    Counter &bytes_received_, &bytes_sent_;
+    // time from the end of the handler to the last byte of the response handed to the socket
+    Histogram &write_time_;
+};
+
+// Limits applied to connections. Timeouts are in seconds, 0 disables a timeout.
+struct ConnectionOptions {
+    // seconds to wait for the next request on an idle connection
+    std::size_t keep_alive_timeout_ = 5;
+    // seconds allowed to receive the request line and headers once a request has started
+    std::size_t header_timeout_ = 10;
+    // seconds to wait for each piece of a request body
+    std::size_t body_timeout_ = 30;
+    // seconds to wait for each piece of a response to be sent
+    std::size_t write_timeout_ = 30;
+    // maximum number of concurrent connections from a single remote address (0 for no limit)
+    std::size_t max_connections_per_address_ = 64;
+    // maximum number of requests served over a single connection (0 disables keep-alive)
+    std::size_t max_keep_alive_requests_ = 100;
+    // maximum size of a request body (0 for no limit)
+    uint64_t max_body_size_ = 32 * 1024 * 1024;
+    // uploaded files larger than this are written to temporary files in upload_dir_ (0 keeps them in memory)
+    std::size_t upload_spool_size_ = 1024 * 1024;
+    std::string upload_dir_;
+    // if set, handlers run on this pool instead of the I/O threads
+    detail::WorkerPool *worker_pool_ = nullptr;
+    // maximum number of requests handled (or waiting for a worker) at once by the server (0 for no limit)
+    std::size_t max_in_flight_requests_ = 0;
+    // if set, counts the requests in flight
+    detail::AdmissionControl *admission_ = nullptr;
+    // if set, connections record their traffic
+    ConnectionMetrics *metrics_ = nullptr;
+};
+
+extern void response_to_buffers(Response &rep, bool, std::string &, std::vector<boost::asio::const_buffer> &);
+
+// complete 503 response closing the connection, sent to clients turned away before reading their request
+extern boost::asio::const_buffer overload_response();
+
+// Buffer sequence referring to the buffers of a vector that outlives the write operation. async_write copies the
+// sequence it is given, so this avoids copying (and allocating) the vector for each write.
+class BufferList {
+public:
+    typedef boost::asio::const_buffer value_type;
+    typedef std::vector<value_type>::const_iterator const_iterator;
+
+    explicit BufferList(const std::vector<value_type> &buffers): begin_(buffers.begin()), end_(buffers.end()) {}
+
+    const_iterator begin() const { return begin_; }
+    const_iterator end() const { return end_; }
+
+private:
+    const_iterator begin_, end_;
+};
 
-extern std::vector<boost::asio::const_buffer> response_to_buffers(Response &rep, bool);
 // Represents a single HttpConnection from a client.
-class HttpConnection : public boost::enable_shared_from_this<HttpConnection> {
+class HttpConnection : public boost::enable_shared_from_this<HttpConnection>,
+        public boost::intrusive::list_base_hook<> {
 public:
-    explicit HttpConnection(boost::asio::ip::tcp::socket socket,
+    explicit HttpConnection(boost::asio::io_service &io_service,
                         ConnectionManager& manager,
-                        FilterChain &handler) : socket_(std::move(socket)),
-        connection_manager_(manager), handler_(handler) {}
+                        const FilterChain &handler,
+                        const ConnectionOptions &options) : io_service_(io_service), socket_(io_service),
+        connection_manager_(manager), handler_(handler), options_(options), timer_(io_service),
+        request_parser_(options.max_body_size_, options.upload_spool_size_, options.upload_dir_) {}
+
+    ~HttpConnection() {
+        if ( address_counter_ ) address_counter_->release(remote_address_);
+        if ( connection_counter_ ) connection_counter_->releaseConnection();
+    }
+
+    boost::asio::ip::tcp::socket &socket() { return socket_; }
 
 private:
     friend class Server;
     friend class ConnectionManager;
+    friend class detail::ConnectionPool;
 
     void start() {
+        setDeadline(options_.header_timeout_);
         read();
     }
     void stop() {
-        socket_.close();
+        boost::system::error_code ignored_ec;
+        timer_.cancel(ignored_ec);
+        socket_.close(ignored_ec);
+    }
+
+    // close the connection unless it makes progress within the given number of seconds (0 for no limit)
+    void setDeadline(std::size_t seconds) {
+        typedef boost::asio::steady_timer::time_point time_point;
+
+        deadline_ = seconds ? boost::asio::steady_timer::clock_type::now() + std::chrono::seconds(seconds) : time_point::max();
+
+        // a pending wait that expires before the deadline is left to expire and then waits for the rest of the time,
+        // so that the timer is not reset on every step of a request
+        if ( deadline_ != time_point::max() && ( !waiting_ || deadline_ < timer_.expires_at() ) ) {
+            timer_.expires_at(deadline_);
+            waitDeadline();
+        }
+    }
+
+    void waitDeadline() {
+        waiting_ = true;
+
+        auto self(this->shared_from_this());
+        timer_.async_wait(makeCustomAllocHandler(timer_memory_, [this, self](boost::system::error_code e) {
+            // the connection has stopped or the wait has been replaced for an earlier deadline
+            if ( e == boost::asio::error::operation_aborted ) return;
+
+            waiting_ = false;
+            if ( deadline_ <= boost::asio::steady_timer::clock_type::now() )
+                connection_manager_.stop(self);
+            else if ( deadline_ != boost::asio::steady_timer::time_point::max() ) {
+                timer_.expires_at(deadline_);
+                waitDeadline();
+            }
+        }));
     }
 
     void read() {
         auto self(this->shared_from_this());
-        socket_.async_read_some(boost::asio::buffer(buffer_), [self, this] (boost::system::error_code e, std::size_t bytes_transferred) {
+        socket_.async_read_some(boost::asio::buffer(buffer_), makeCustomAllocHandler(read_memory_, [self, this] (boost::system::error_code e, std::size_t bytes_transferred) {
             if (!e) {
-                boost::tribool result;
-                result = request_parser_.parse(buffer_.data(), bytes_transferred);
-
-                if ( result ) {
-                    if ( !request_parser_.decode_message(request_) ) {
-                        response_.stockReply(Response::bad_request);
-                    } else {
-                        request_.SERVER_.add("REMOTE_ADDR", socket_.remote_endpoint().address().to_string() );
-                        try {
-                            handler_.handle(request_, response_);
-                            if ( response_.status_ != Response::ok )
-                                response_.stockReply(response_.status_);
-                        } catch ( HttpResponseException &e  ) {
-                        response_.status_ = e.code_;
-                        if ( e.reason_.empty() ) {
-                            response_.stockReply(e.code_);
-                        } else {
-                            response_.content_.assign(e.reason_);
-                            response_.setContentType("text/html");
-                            response_.setContentLength();
-                        }
-                        } catch ( std::runtime_error &e ) {
-                        std::cout << e.what() << std::endl;
-                        response_.stockReply(Response::internal_server_error);
-                        }
-                    }
-
-                    write(response_to_buffers(response_, request_.method_ == "HEAD"));
-                } else if (!result) {
-                    response_.stockReply(Response::bad_request);
-                    write(response_to_buffers(response_, request_.method_ == "HEAD"));
-
-                } else {
-                    read();
+                if ( options_.metrics_ ) options_.metrics_->bytes_received_.inc(MetricLabels(), bytes_transferred);
+
+                // a new request starts on an idle connection
+                if ( idle_ ) {
+                    idle_ = false;
+                    setDeadline(options_.header_timeout_);
                 }
+                consume(0, bytes_transferred);
             } else if (e != boost::asio::error::operation_aborted) {
                 connection_manager_.stop(self);
             }
+        }));
+    }
+
+    // feed the parser with buffer_[begin, end), bytes after the end of the current message are kept for the next one
+    void consume(std::size_t begin, std::size_t end) {
+        std::size_t used = 0;
+        boost::tribool result = request_parser_.parse(buffer_.data() + begin, end - begin, used);
+
+        pending_begin_ = begin + used;
+        pending_end_ = end;
+
+        if ( result ) {
+            // the time spent by the handler is not limited
+            setDeadline(0);
+
+            keep_alive_ = request_parser_.keepAlive() &&
+                    ++num_requests_ < options_.max_keep_alive_requests_;
+
+            if ( !request_parser_.decode_message(request_) ) {
+                response_.stockReply(Response::bad_request);
+                write();
+            } else {
+                request_.SERVER_.add("REMOTE_ADDR", remote_address_.to_string() );
+                dispatch();
+            }
+        } else if (!result) {
+            keep_alive_ = false;
+            // a body too large is rejected as soon as its length is known, while the client is still sending it
+            drain_ = request_parser_.bodyTooLarge();
+            response_.stockReply(drain_ ? Response::payload_too_large : Response::bad_request);
+            write();
+        } else {
+            // slow clients may send the headers in many pieces but must complete them within the header timeout
+            if ( request_parser_.headersComplete() )
+                setDeadline(options_.body_timeout_);
+            read();
+        }
+    }
+
+    // run the handler on the worker pool if there is one, otherwise on this thread, and send the response
+    void dispatch() {
+        detail::AdmissionControl *admission = options_.admission_;
+        if ( admission && !admission->acquireRequest(options_.max_in_flight_requests_) ) {
+            overloaded();
+            write();
+            return;
+        }
+
+        if ( handler_.isAsync() ) {
+            // the handler yields to the other connections of this thread while it waits
+            auto self(this->shared_from_this());
+            boost::asio::spawn(io_service_, [this, self] (boost::asio::yield_context yield) {
+                handle(&yield);
+                handled();
+                write();
+            });
+            return;
+        }
+
+        detail::WorkerPool *workers = options_.worker_pool_;
+        if ( !workers ) {
+            handle();
+            handled();
+            write();
+            return;
+        }
+
+        // nothing else happens on the connection until the response is written on its own thread
+        auto self(this->shared_from_this());
+        bool queued = workers->post([this, self] (bool run) {
+            if ( run )
+                handle();
+            else {
+                // the request waited so long that the client has likely given up, skip it to catch up
+                if ( options_.admission_ ) options_.admission_->requestDropped();
+                overloaded();
+            }
+            handled();
+            io_service_.post(makeCustomAllocHandler(read_memory_, [this, self] { write(); }));
         });
+
+        if ( !queued ) {
+            // all workers are busy and enough requests are waiting, reply at once rather than let it wait
+            if ( admission ) admission->requestRejected();
+            handled();
+            overloaded();
+            write();
+        }
+    }
+
+    // the request is no longer in flight
+    void handled() {
+        if ( options_.admission_ ) options_.admission_->releaseRequest();
+    }
+
+    // reply without running the handler when the server has too much work
+    void overloaded() {
+        response_.stockReply(Response::service_unavailable);
+        response_.headers_.replace("Retry-After", "1");
+    }
+
+    // pass the request to the handler and fill in the response, yield is given when running in a coroutine
+    void handle(boost::asio::yield_context *yield = nullptr) {
+        try {
+            if ( yield )
+                handler_.handle(request_, response_, io_service_, *yield);
+            else
+                handler_.handle(request_, response_);
+            if ( response_.status_ != Response::ok && response_.status_ != Response::partial_content )
+                response_.stockReply(response_.status_);
+        } catch ( HttpResponseException &e  ) {
+            response_.status_ = e.code_;
+            if ( e.reason_.empty() ) {
+                response_.stockReply(e.code_);
+            } else {
+                response_.file_.reset();
+                response_.generator_ = nullptr;
+                response_.content_.assign(e.reason_);
+                response_.setContentType("text/html");
+                response_.setContentLength();
+            }
+        } catch ( std::runtime_error &e ) {
+            std::cout << e.what() << std::endl;
+            response_.stockReply(Response::internal_server_error);
+        }
     }
 
-    void write(const std::vector<boost::asio::const_buffer> &buffers)  {
+    void write()  {
+        // the handler may request closing the connection
+        if ( response_.headers_.get("Connection") == "close" )
+            keep_alive_ = false;
+
+        // the client relies on the content length to delimit responses on a persistent connection, it is added
+        // when the response is serialized unless the body is streamed
+        if ( response_.generator_ ) {
+            if ( !response_.headers_.contains("Content-Length") ) {
+                if ( request_.protocol_ == "HTTP/1.1" ) {
+                    chunked_ = true;
+                    response_.headers_.replace("Transfer-Encoding", "chunked");
+                }
+                else keep_alive_ = false;
+            }
+        }
+
+        response_.headers_.replace("Connection", keep_alive_ ? "keep-alive" : "close");
+
+        bool is_head = request_.method_ == "HEAD";
+
+        setDeadline(options_.write_timeout_);
+        if ( options_.metrics_ ) write_start_ = std::chrono::steady_clock::now();
+
         auto self(this->shared_from_this());
-        boost::asio::async_write(socket_, buffers, [this, self](boost::system::error_code e, std::size_t) {
-            if (!e) {
-                // Initiate graceful Connection closure.
-                boost::system::error_code ignored_ec;
-                socket_.shutdown(boost::asio::ip::tcp::socket::shutdown_both, ignored_ec);
+        response_to_buffers(response_, is_head, header_buffer_, buffers_);
+        boost::asio::async_write(socket_, BufferList(buffers_), makeCustomAllocHandler(write_memory_, [this, self, is_head](boost::system::error_code e, std::size_t n) {
+            bytes_sent_ += n;
+            if ( !e && !is_head && response_.generator_ )
+                writeStream();
+            // files that have not been read are streamed after the headers
+            else if ( !e && !is_head && response_.file_ && !response_.file_->data() ) {
+                file_range_ = 0;
+                writeFileRange();
             }
+            else
+                finish(e);
+       }));
+    }
 
-            if (e != boost::asio::error::operation_aborted) {
-                connection_manager_.stop(self);
+    // send the text preceding the next range of the response file (see Response::ranges_) and then transmit the
+    // range, or the text following the last range
+    void writeFileRange() {
+        const std::vector<Response::FileRange> &ranges = response_.ranges_;
+
+        // the whole file
+        if ( ranges.empty() ) {
+            if ( file_range_++ > 0 ) finish(boost::system::error_code());
+            else {
+                file_offset_ = 0;
+                file_end_ = response_.file_->size();
+                transmitFile();
             }
-       });
+            return;
+        }
+
+        if ( file_range_ > ranges.size() ) {
+            finish(boost::system::error_code());
+            return;
+        }
+
+        bool last = file_range_ == ranges.size();
+        const std::string &text = last ? response_.ranges_suffix_ : ranges[file_range_].prefix_;
+        if ( !last ) {
+            file_offset_ = ranges[file_range_].offset_;
+            file_end_ = file_offset_ + ranges[file_range_].length_;
+        }
+        file_range_++;
+
+        if ( text.empty() ) {
+            if ( last ) finish(boost::system::error_code());
+            else transmitFile();
+            return;
+        }
+
+        setDeadline(options_.write_timeout_);
+
+        auto self(this->shared_from_this());
+        boost::asio::async_write(socket_, boost::asio::buffer(text), makeCustomAllocHandler(write_memory_, [this, self, last](boost::system::error_code e, std::size_t n) {
+            bytes_sent_ += n;
+            if ( e || last ) finish(e);
+            else transmitFile();
+        }));
     }
 
+#ifdef __linux__
+    // send the range of the response file with sendfile(2) as the socket becomes writable
+    void transmitFile() {
+        setDeadline(options_.write_timeout_);
+
+        auto self(this->shared_from_this());
+        socket_.async_write_some(boost::asio::null_buffers(), makeCustomAllocHandler(write_memory_, [this, self](boost::system::error_code e, std::size_t) {
+            if ( e ) {
+                finish(e);
+                return;
+            }
+
+            if ( !socket_.native_non_blocking() )
+                socket_.native_non_blocking(true, e);
+
+            const FileBody &file = *response_.file_;
+
+            while ( !e && file_offset_ < file_end_ ) {
+                off_t offset = file_offset_;
+                ssize_t n = ::sendfile(socket_.native_handle(), file.fd(), &offset, file_end_ - file_offset_);
+
+                if ( n > 0 ) {
+                    file_offset_ = offset;
+                    bytes_sent_ += n;
+                }
+                else if ( n == 0 )
+                    e = boost::asio::error::eof;
+                else if ( errno == EAGAIN || errno == EWOULDBLOCK ) {
+                    transmitFile();
+                    return;
+                }
+                else if ( errno != EINTR )
+                    e = boost::system::error_code(errno, boost::asio::error::get_system_category());
+            }
+
+            if ( e ) finish(e);
+            else writeFileRange();
+        }));
+    }
+#else
+    // send the range of the response file in chunks
+    void transmitFile() {
+        const FileBody &file = *response_.file_;
+        if ( file_offset_ >= file_end_ ) {
+            writeFileRange();
+            return;
+        }
+
+        file_chunk_ = file.read(file_offset_, std::min<uint64_t>(FileBody::max_loaded_size, file_end_ - file_offset_));
+        file_offset_ += file_chunk_.size();
+
+        setDeadline(options_.write_timeout_);
+
+        auto self(this->shared_from_this());
+        boost::asio::async_write(socket_, boost::asio::buffer(file_chunk_), makeCustomAllocHandler(write_memory_, [this, self](boost::system::error_code e, std::size_t n) {
+            bytes_sent_ += n;
+            if ( e || file_chunk_.empty() ) finish(e);
+            else transmitFile();
+        }));
+    }
+#endif
+
+    // write the next piece of a streamed body once the previous one has been sent
+    void writeStream() {
+        std::ostringstream strm;
+        bool more;
+
+        try {
+            more = response_.generator_(strm);
+        } catch ( std::exception &e ) {
+            // headers have already been sent so the only option is to abort the response
+            std::cout << e.what() << std::endl;
+            connection_manager_.stop(shared_from_this());
+            return;
+        }
+
+        stream_chunk_ = strm.str();
+
+        std::vector<boost::asio::const_buffer> &buffers = buffers_;
+        buffers.clear();
+        if ( chunked_ ) {
+            static const char crlf[] = { '\r', '\n' };
+            static const char last_chunk[] = { '0', '\r', '\n', '\r', '\n' };
+
+            if ( !stream_chunk_.empty() ) {
+                char header[20];
+                chunk_header_.assign(header, snprintf(header, sizeof(header), "%zx\r\n", stream_chunk_.size()));
+
+                buffers.push_back(boost::asio::buffer(chunk_header_));
+                buffers.push_back(boost::asio::buffer(stream_chunk_));
+                buffers.push_back(boost::asio::buffer(crlf));
+            }
+
+            if ( !more )
+                buffers.push_back(boost::asio::buffer(last_chunk));
+        }
+        else
+            buffers.push_back(boost::asio::buffer(stream_chunk_));
+
+        setDeadline(options_.write_timeout_);
+
+        auto self(this->shared_from_this());
+        boost::asio::async_write(socket_, BufferList(buffers), makeCustomAllocHandler(write_memory_, [this, self, more](boost::system::error_code e, std::size_t n) {
+            bytes_sent_ += n;
+            if ( !e && more ) writeStream();
+            else finish(e);
+        }));
+    }
+
+    // called when the response has been sent
+    void finish(const boost::system::error_code &e) {
+        if ( ConnectionMetrics *metrics = options_.metrics_ ) {
+            metrics->bytes_sent_.inc(MetricLabels(), bytes_sent_);
+            metrics->write_time_.observe(MetricLabels(), std::chrono::duration<double>(std::chrono::steady_clock::now() - write_start_).count());
+        }
+        bytes_sent_ = 0;
+
+        if ( !e && keep_alive_ ) {
+            next();
+            return;
+        }
+
+        if ( !e && drain_ ) {
+            lingeringClose();
+            return;
+        }
+
+        if (!e) {
+            // Initiate graceful Connection closure.
+            boost::system::error_code ignored_ec;
+            socket_.shutdown(boost::asio::ip::tcp::socket::shutdown_both, ignored_ec);
+        }
+
+        if (e != boost::asio::error::operation_aborted) {
+            connection_manager_.stop(shared_from_this());
+        }
+    }
+
+    // Stop sending and discard what the client still sends until it closes or for linger_time seconds. Closing with
+    // unread data makes the kernel reset the connection, and the client would likely lose the response.
+    void lingeringClose() {
+        boost::system::error_code ignored_ec;
+        socket_.shutdown(boost::asio::ip::tcp::socket::shutdown_send, ignored_ec);
+        setDeadline(linger_time);
+        discard();
+    }
+
+    void discard() {
+        auto self(this->shared_from_this());
+        socket_.async_read_some(boost::asio::buffer(buffer_), makeCustomAllocHandler(read_memory_, [self, this] (boost::system::error_code e, std::size_t) {
+            if ( !e ) discard();
+            else if ( e != boost::asio::error::operation_aborted ) connection_manager_.stop(self);
+        }));
+    }
+
+    // clear the request and response keeping their memory, except for exceptionally large bodies
+    void clear() {
+        static const std::size_t max_retained_body = 64 * 1024;
+
+        if ( request_.content_.capacity() > max_retained_body ) std::string().swap(request_.content_);
+        if ( response_.content_.capacity() > max_retained_body ) std::string().swap(response_.content_);
+
+        chunked_ = false;
+        request_parser_.reset();
+        request_.clear();
+        response_.clear();
+    }
+
+    // reset a closed connection so that the object may serve a new client (see ConnectionPool)
+    void recycle() {
+        if ( address_counter_ ) address_counter_->release(remote_address_);
+        address_counter_ = nullptr;
+        if ( connection_counter_ ) connection_counter_->releaseConnection();
+        connection_counter_ = nullptr;
+
+        boost::system::error_code ignored_ec;
+        socket_.close(ignored_ec);
+
+        clear();
+        pending_begin_ = pending_end_ = 0;
+        num_requests_ = 0;
+        keep_alive_ = false;
+        drain_ = false;
+        waiting_ = false;
+        idle_ = false;
+    }
+
+    // prepare for the next request on the same connection
+    void next() {
+        clear();
+
+        // serve pipelined requests first
+        if ( pending_begin_ < pending_end_ ) {
+            setDeadline(options_.header_timeout_);
+            consume(pending_begin_, pending_end_);
+            return;
+        }
+
+        idle_ = true;
+        setDeadline(options_.keep_alive_timeout_);
+        read();
+    }
+
+    boost::asio::io_service &io_service_;
     boost::asio::ip::tcp::socket socket_;
 
     // The handler of incoming HttpRequest.
-    FilterChain &handler_;
+    const FilterChain &handler_;
 
     // Buffer for incoming data.
     boost::array<char, 8192> buffer_;
 
+    // Range of bytes in buffer_ that belong to pipelined requests not yet parsed
+    std::size_t pending_begin_ = 0, pending_end_ = 0;
+
+    // Offset of the next byte of the response file to send, the end of the range being sent and the index of the
+    // next range (see writeFileRange)
+    uint64_t file_offset_ = 0, file_end_ = 0;
+    std::size_t file_range_ = 0;
+
+    // Buffers of the response being sent and its serialized status line and headers, kept to reuse their memory
+    std::vector<boost::asio::const_buffer> buffers_;
+    std::string header_buffer_;
+
+    // The last piece of a streamed body and its chunk header while they are being sent
+    std::string stream_chunk_, chunk_header_;
+    bool chunked_ = false;
+#ifndef __linux__
+    std::string file_chunk_;
+#endif
+
     ConnectionManager& connection_manager_;
 
+    const ConnectionOptions &options_;
+
+    // Closes the connection when a request, a response or the next request on an idle connection
+    // does not make progress in time
+    boost::asio::steady_timer timer_;
+    boost::asio::steady_timer::time_point deadline_;
+    bool waiting_ = false, idle_ = false;
+
+    // Memory for the handlers of read, write and timer operations, so that they do not allocate memory
+    HandlerMemory read_memory_, write_memory_, timer_memory_;
+
     // The parser for the incoming HttpRequest.
     detail::RequestParser request_parser_;
 
     Request request_;
     Response response_;
+
+    std::size_t num_requests_ = 0;
+    bool keep_alive_ = false;
+
+    // the request has not been read to its end, it is drained before closing (see lingeringClose)
+    bool drain_ = false;
+    static const std::size_t linger_time = 1;
+
+    // bytes of the current response sent so far and when it started (if metrics are recorded)
+    uint64_t bytes_sent_ = 0;
+    std::chrono::steady_clock::time_point write_start_;
+
+    // Shard of the connection manager and owning reference held while registered there
+    std::size_t shard_ = 0;
+    ConnectionPtr registered_;
+
+    // Address of the client, counted in address_counter_ (if set) while the connection exists
+    boost::asio::ip::address remote_address_;
+    ConnectionsPerAddress *address_counter_ = nullptr;
+
+    // Counts the connection among the open connections of the server (if set) while it exists
+    detail::AdmissionControl *connection_counter_ = nullptr;
 };
 } // namespace server
 } // namespace wspp
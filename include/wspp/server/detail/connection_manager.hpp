@@ -1,9 +1,13 @@
 #ifndef __SERVER_CONNECTION_MANAGER_HPP__
 #define __SERVER_CONNECTION_MANAGER_HPP__
 
-#include <set>
+#include <vector>
+#include <memory>
+#include <map>
 #include <boost/shared_ptr.hpp>
-#include <boost/thread.hpp>
+#include <boost/intrusive/list_hook.hpp>
+#include <boost/asio/ip/address.hpp>
+#include <boost/thread/mutex.hpp>
 
 namespace wspp {
 namespace server {
@@ -12,16 +16,19 @@ typedef boost::shared_ptr<HttpConnection> ConnectionPtr;
 
 // Manages open connections so that they may be cleanly stopped when the server
 // needs to shut down.
+// Connections are kept in intrusive lists (no allocation on registration) split into shards. Normally there is one
+// shard per thread serving connections so that registering and removing connections does not contend across threads.
 class ConnectionManager{
 public:
     ConnectionManager(const ConnectionManager&) = delete;
     ConnectionManager& operator=(const ConnectionManager&) = delete;
 
     // Construct a connection manager.
-    ConnectionManager();
+    explicit ConnectionManager(std::size_t num_shards = 1);
+    ~ConnectionManager();
 
-    // Add the specified connection to the manager and start it.
-    void start(ConnectionPtr c);
+    // Add the specified connection to the given shard of the manager and start it.
+    void start(ConnectionPtr c, std::size_t shard = 0);
 
     // Stop the specified connection.
     void stop(ConnectionPtr c);
@@ -29,12 +36,35 @@ public:
     // Stop all connections.
     void stop_all();
 
+    // Stop the connections of a shard.
+    void stop_all(std::size_t shard);
+
 private:
+    struct Shard;
+
     // The managed connections.
-    std::set<ConnectionPtr> connections_;
+    std::vector<std::unique_ptr<Shard>> shards_;
+};
+
+// Counts the open connections of each remote address so that a single client cannot hold all the connections
+// (and file descriptors) of the server, e.g. by opening many connections and sending requests very slowly.
+class ConnectionsPerAddress {
+public:
+    ConnectionsPerAddress(const ConnectionsPerAddress&) = delete;
+    ConnectionsPerAddress& operator=(const ConnectionsPerAddress&) = delete;
+
+    ConnectionsPerAddress() = default;
+
+    // Register a connection from the address unless there are already max_connections (if not 0) from it.
+    bool acquire(const boost::asio::ip::address &address, std::size_t max_connections);
+
+    // Unregister a connection acquired before.
+    void release(const boost::asio::ip::address &address);
+
+private:
+    std::map<boost::asio::ip::address, std::size_t> counts_;
     boost::mutex mutex_;
 };
 } // namespace server
 } // namespace wspp
 #endif
-
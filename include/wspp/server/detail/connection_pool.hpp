@@ -0,0 +1,50 @@
+#ifndef __SERVER_CONNECTION_POOL_HPP__
+#define __SERVER_CONNECTION_POOL_HPP__
+
+#include <vector>
+#include <memory>
+#include <boost/asio.hpp>
+#include <boost/shared_ptr.hpp>
+
+#include <wspp/server/detail/connection_manager.hpp>
+
+namespace wspp {
+namespace server {
+class FilterChain;
+struct ConnectionOptions;
+
+namespace detail {
+
+// Recycles connection objects, so that once the pool is warm accepting a connection does not allocate a new
+// HttpConnection with its buffer, parser, request and response (and the memory these have grown to hold).
+// A connection returns to the pool when its last reference is dropped. The pool is split into shards, one per
+// io_service of the server, since connections are bound to the io_service of their socket; all connections of a
+// shard should be created for the same io_service, connection manager, handler and options.
+// The pool is held by a shared pointer so that connections released after it has been destroyed are deleted.
+class ConnectionPool: public std::enable_shared_from_this<ConnectionPool> {
+public:
+    ConnectionPool(const ConnectionPool&) = delete;
+    ConnectionPool& operator=(const ConnectionPool&) = delete;
+
+    // keep up to max_free unused connections in each of num_shards shards
+    ConnectionPool(std::size_t num_shards, std::size_t max_free);
+    ~ConnectionPool();
+
+    // get an unused connection of the shard or create a new one
+    ConnectionPtr create(std::size_t shard, boost::asio::io_service &io, ConnectionManager &manager,
+                         const FilterChain &handler, const ConnectionOptions &options);
+
+private:
+    struct Shard;
+    struct Recycler;
+
+    void recycle(std::size_t shard, HttpConnection *c);
+
+    std::vector<std::unique_ptr<Shard>> shards_;
+    std::size_t max_free_;
+};
+
+} // namespace detail
+} // namespace server
+} // namespace wspp
+#endif
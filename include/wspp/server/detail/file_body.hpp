@@ -0,0 +1,59 @@
+#ifndef __SERVER_FILE_BODY_HPP__
+#define __SERVER_FILE_BODY_HPP__
+
+#include <string>
+#include <memory>
+#include <ctime>
+#include <cstdint>
+
+#include <boost/noncopyable.hpp>
+
+namespace wspp {
+namespace server {
+namespace detail {
+
+// An open read-only file used as the payload of a response so that it is never copied in memory.
+// Small files are read at once and sent together with the headers, larger ones are streamed with sendfile(2).
+// Small files are not memory mapped since the process would get SIGBUS if the file was truncated while being sent.
+// A large file truncated while being sent ends the connection with the body cut short.
+// A body may also hold the contents of a file in memory (see fromMemory), e.g. cached or compressed.
+class FileBody: private boost::noncopyable {
+public:
+    ~FileBody();
+
+    // Open the file and get its size and modification time, and read it if it is small. Returns null if the file is
+    // not a regular readable file.
+    static std::shared_ptr<FileBody> open(const std::string &path);
+
+    // A body holding the given contents, with the modification time and inode of the file they come from
+    static std::shared_ptr<FileBody> fromMemory(std::string contents, time_t mtime, uint64_t inode);
+
+    int fd() const { return fd_; }
+    uint64_t size() const { return size_; }
+    time_t mtime() const { return mtime_; }
+    uint64_t inode() const { return inode_; }
+
+    // The contents of the file if it has been read or is held in memory, otherwise null
+    const char *data() const { return data_; }
+
+    // read count bytes starting at offset
+    std::string read(uint64_t offset, uint64_t count) const;
+
+    // files up to this size are read when opened
+    static const uint64_t max_loaded_size = 64 * 1024;
+
+private:
+    FileBody() = default;
+
+    int fd_ = -1;
+    uint64_t size_ = 0;
+    time_t mtime_ = 0;
+    uint64_t inode_ = 0;
+    std::string contents_;
+    const char *data_ = nullptr;
+};
+
+} // namespace detail
+} // namespace server
+} // namespace wspp
+#endif
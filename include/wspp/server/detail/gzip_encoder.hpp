@@ -0,0 +1,32 @@
+#ifndef __SERVER_GZIP_ENCODER_HPP__
+#define __SERVER_GZIP_ENCODER_HPP__
+
+#include <string>
+
+#include <boost/noncopyable.hpp>
+#include <zlib.h>
+
+namespace wspp {
+namespace server {
+namespace detail {
+
+// Compresses data in the gzip format, either as a whole or piece by piece (e.g. a streamed body)
+class GzipEncoder: private boost::noncopyable {
+public:
+    explicit GzipEncoder(int level = Z_DEFAULT_COMPRESSION);
+    ~GzipEncoder();
+
+    // compress the next piece of data appending the output to out, finish ends the stream
+    void compress(const char *data, std::size_t size, std::string &out, bool finish);
+
+    // compress data as a whole replacing the contents of out, whose memory is reused
+    static void compress(const char *data, std::size_t size, std::string &out, int level);
+
+private:
+    z_stream strm_;
+};
+
+} // namespace detail
+} // namespace server
+} // namespace wspp
+#endif
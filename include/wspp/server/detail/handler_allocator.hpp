@@ -0,0 +1,102 @@
+//
+// handler_allocator.hpp
+// ~~~~~~~~~~~~~~~~~~~~~
+//
+// Copyright (c) 2003-2012 Christopher M. Kohlhoff (chris at kohlhoff dot com)
+//
+// Distributed under the Boost Software License, Version 1.0. (See accompanying
+// file LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+//
+
+// adopted from the custom memory allocation example of boost::asio
+
+#ifndef HTTP_SERVER_HANDLER_ALLOCATOR_HPP
+#define HTTP_SERVER_HANDLER_ALLOCATOR_HPP
+
+#include <boost/noncopyable.hpp>
+
+#include <cstddef>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+namespace wspp {
+namespace server {
+namespace detail {
+
+// Memory for the handlers of the asynchronous operations of a connection. The operations of a connection are
+// started one after the other, so a couple of fixed slots (an operation may be started before a cancelled one
+// has completed) are enough to avoid allocating memory for each of them. Larger handlers fall back to the heap.
+class HandlerMemory: private boost::noncopyable {
+public:
+    static const std::size_t num_slots = 2;
+    static const std::size_t slot_size = 512;
+
+    HandlerMemory() {
+        for( std::size_t i = 0 ; i < num_slots ; i++ ) in_use_[i] = false;
+    }
+
+    void *allocate(std::size_t size) {
+        if ( size <= slot_size ) {
+            for( std::size_t i = 0 ; i < num_slots ; i++ ) {
+                if ( !in_use_[i] ) {
+                    in_use_[i] = true;
+                    return &storage_[i];
+                }
+            }
+        }
+
+        return ::operator new(size);
+    }
+
+    void deallocate(void *pointer) {
+        for( std::size_t i = 0 ; i < num_slots ; i++ ) {
+            if ( pointer == &storage_[i] ) {
+                in_use_[i] = false;
+                return;
+            }
+        }
+
+        ::operator delete(pointer);
+    }
+
+private:
+    typename std::aligned_storage<slot_size>::type storage_[num_slots];
+    bool in_use_[num_slots];
+};
+
+// Wrapper of a completion handler that allocates the memory of the operation from a HandlerMemory
+template <class Handler>
+class CustomAllocHandler {
+public:
+    CustomAllocHandler(HandlerMemory &memory, Handler handler): memory_(memory), handler_(std::move(handler)) {}
+
+    template <class ...Args>
+    void operator()(Args&&... args) {
+        handler_(std::forward<Args>(args)...);
+    }
+
+    friend void *asio_handler_allocate(std::size_t size, CustomAllocHandler<Handler> *this_handler) {
+        return this_handler->memory_.allocate(size);
+    }
+
+    friend void asio_handler_deallocate(void *pointer, std::size_t /*size*/, CustomAllocHandler<Handler> *this_handler) {
+        this_handler->memory_.deallocate(pointer);
+    }
+
+private:
+    HandlerMemory &memory_;
+    Handler handler_;
+};
+
+// Helper function to wrap a handler object to add custom allocation.
+template <class Handler>
+inline CustomAllocHandler<Handler> makeCustomAllocHandler(HandlerMemory &memory, Handler handler) {
+    return CustomAllocHandler<Handler>(memory, std::move(handler));
+}
+
+} // namespace detail
+} // namespace server
+} // namespace wspp
+
+#endif
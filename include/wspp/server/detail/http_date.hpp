@@ -0,0 +1,35 @@
+#ifndef __SERVER_HTTP_DATE_HPP__
+#define __SERVER_HTTP_DATE_HPP__
+
+#include <string>
+#include <ctime>
+
+namespace wspp {
+namespace server {
+namespace detail {
+
+// Dates in the format of HTTP headers (e.g. "Sun, 06 Nov 1994 08:49:37 GMT"). The current date is formatted
+// once per second by update() (called from a timer of the server) rather than for every response.
+class HttpDate {
+public:
+    // length of a formatted date
+    static const std::size_t size = 29;
+
+    // format t into buf, which must hold size + 1 characters
+    static void format(time_t t, char *buf);
+
+    // parse a date in the preferred format (as produced by format), returns false if it is not valid
+    static bool parse(const std::string &date, time_t &t);
+
+    // refresh the current date, may be called from any thread
+    static void update();
+
+    // append the "Date" header line (terminated by CRLF) of the current date
+    static void appendHeader(std::string &buf);
+};
+
+} // namespace detail
+} // namespace server
+} // namespace wspp
+
+#endif
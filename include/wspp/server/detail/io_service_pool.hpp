@@ -12,6 +12,7 @@
 #define HTTP_SERVER_IO_SERVICE_POOL_HPP
 
 #include <boost/asio.hpp>
+#include <atomic>
 #include <vector>
 #include <boost/noncopyable.hpp>
 #include <boost/shared_ptr.hpp>
@@ -27,15 +28,25 @@ public:
     // Construct the io_service pool.
     explicit io_service_pool(std::size_t pool_size);
 
-    // Run all io_service objects in the pool.
-    void run();
+    // Run all io_service objects in the pool. Each one is run by its own thread. If pin_threads is true
+    // each thread is bound to a separate CPU (where supported).
+    void run(bool pin_threads = false);
 
     // Stop all io_service objects in the pool.
     void stop();
 
-    // Get an io_service to use.
+    // Get an io_service to use (round-robin). May be called from any thread.
     boost::asio::io_service& get_io_service();
 
+    // Get the io_service with the given index
+    boost::asio::io_service& get_io_service(std::size_t index);
+
+    // Index of the next io_service to use (round-robin)
+    std::size_t next_index();
+
+    // number of io_services in the pool
+    std::size_t size() const { return io_services_.size(); }
+
 private:
     typedef boost::shared_ptr<boost::asio::io_service> io_service_ptr;
     typedef boost::shared_ptr<boost::asio::io_service::work> work_ptr;
@@ -47,7 +58,7 @@ private:
     std::vector<work_ptr> work_;
 
     // The next io_service to use for a connection.
-    std::size_t next_io_service_;
+    std::atomic<std::size_t> next_io_service_;
 };
 } // namespace detail
 } // namespace server
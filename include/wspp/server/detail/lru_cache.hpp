@@ -0,0 +1,82 @@
+#ifndef __SERVER_LRU_CACHE_HPP__
+#define __SERVER_LRU_CACHE_HPP__
+
+#include <list>
+#include <unordered_map>
+
+#include <boost/noncopyable.hpp>
+#include <boost/thread/mutex.hpp>
+
+namespace wspp {
+namespace server {
+namespace detail {
+
+// A map with a budget on the total cost (e.g. the memory) of its values, evicting the least recently used values
+// when it is exceeded. Values should be cheap to copy (e.g. shared pointers). May be used from any thread.
+template <class Key, class Value>
+class LruCache: private boost::noncopyable {
+public:
+    explicit LruCache(std::size_t max_cost): max_cost_(max_cost) {}
+
+    // copy the value of key and make it the most recently used, returns false if it is not cached
+    bool get(const Key &key, Value &value) {
+        boost::unique_lock<boost::mutex> lock(mutex_);
+        auto it = entries_.find(key);
+        if ( it == entries_.end() ) return false;
+
+        lru_.splice(lru_.begin(), lru_, it->second.lru_);
+        value = it->second.value_;
+        return true;
+    }
+
+    // add or replace the value of key, values costing more than the whole budget are not cached
+    void put(const Key &key, const Value &value, std::size_t cost) {
+        boost::unique_lock<boost::mutex> lock(mutex_);
+        auto it = entries_.find(key);
+        if ( it != entries_.end() ) remove(it);
+        if ( cost > max_cost_ ) return;
+
+        while ( cost_ + cost > max_cost_ && !lru_.empty() )
+            remove(entries_.find(lru_.back()));
+
+        lru_.push_front(key);
+        entries_.emplace(key, Entry{value, cost, lru_.begin()});
+        cost_ += cost;
+    }
+
+    void erase(const Key &key) {
+        boost::unique_lock<boost::mutex> lock(mutex_);
+        auto it = entries_.find(key);
+        if ( it != entries_.end() ) remove(it);
+    }
+
+    // total cost of the cached values
+    std::size_t cost() const {
+        boost::unique_lock<boost::mutex> lock(mutex_);
+        return cost_;
+    }
+
+private:
+    struct Entry {
+        Value value_;
+        std::size_t cost_;
+        typename std::list<Key>::iterator lru_;
+    };
+
+    void remove(typename std::unordered_map<Key, Entry>::iterator it) {
+        cost_ -= it->second.cost_;
+        lru_.erase(it->second.lru_);
+        entries_.erase(it);
+    }
+
+    std::size_t max_cost_, cost_ = 0;
+    std::unordered_map<Key, Entry> entries_;
+    // keys from the most to the least recently used
+    std::list<Key> lru_;
+    mutable boost::mutex mutex_;
+};
+
+} // namespace detail
+} // namespace server
+} // namespace wspp
+#endif
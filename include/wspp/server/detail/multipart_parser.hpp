@@ -0,0 +1,75 @@
+#ifndef HTTP_SERVER_MULTIPART_PARSER_HPP
+#define HTTP_SERVER_MULTIPART_PARSER_HPP
+
+#include <string>
+#include <vector>
+#include <map>
+#include <fstream>
+
+#include <wspp/server/request.hpp>
+
+namespace wspp {
+namespace server {
+namespace detail {
+
+// Incremental parser of multipart/form-data bodies. It is fed with the pieces of the body as they arrive so that the
+// body is never buffered as a whole. Form fields are kept in memory while uploaded files larger than the spool
+// threshold are written to temporary files (see Request::UploadedFile::path_). Temporary files are deleted when
+// the parser is destroyed, i.e. after the response has been sent, unless the handler has moved them.
+//
+// Part data are located with a Boyer-Moore-Horspool search for the delimiter directly in the received pieces and
+// are passed on without intermediate copies. Only header lines split between pieces are buffered.
+class MultipartParser {
+public:
+    // spool_threshold of 0 keeps all uploads in memory, an empty spool_dir uses the system temporary folder
+    MultipartParser(const std::string &boundary, size_t spool_threshold, const std::string &spool_dir);
+    ~MultipartParser();
+
+    // parse the next piece of the body, returns false on malformed data or if a temporary file cannot be written
+    bool feed(const char *data, size_t size);
+
+    // true if the closing boundary has been seen
+    bool isComplete() const;
+
+    // move the parsed fields and files in the request
+    void decode(Request &req);
+
+private:
+    enum State { Preamble, Delimiter, Headers, Body, Done };
+
+    const char *parseBody(const char *p, const char *end);
+    size_t findDelimiter(const char *data, size_t size) const;
+    size_t partialDelimiter(const char *data, size_t size) const;
+
+    bool readLine(const char *&p, const char *end, const char *&line, size_t &len);
+    void parseHeader(const char *data, size_t size);
+
+    void startPart();
+    bool appendPart(const char *data, size_t size);
+    void endPart();
+
+    std::string delimiter_; // CRLF--boundary
+    size_t skip_[256];      // Horspool shift table of the delimiter
+    size_t spool_threshold_;
+    std::string spool_dir_;
+
+    State state_ = Preamble;
+    std::string buffer_;    // partial header line
+    size_t matched_ = 0;    // length of delimiter prefix seen at the end of the previous piece
+
+    // current part
+    std::string field_, file_name_, content_type_, data_;
+    size_t size_ = 0;
+    std::ofstream spool_strm_;
+    std::string spool_path_;
+
+    Dictionary fields_;
+    std::map<std::string, Request::UploadedFile> files_;
+    std::vector<std::string> spooled_files_;
+};
+
+} // namespace detail
+} // namespace server
+} // namespace wspp
+
+#endif
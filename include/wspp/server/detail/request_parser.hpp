@@ -14,8 +14,12 @@
 #include <boost/logic/tribool.hpp>
 #include <boost/tuple/tuple.hpp>
 #include <map>
+#include <memory>
+#include <string>
 
 #include <wspp/server/detail/http_parser.h>
+#include <wspp/server/detail/multipart_parser.hpp>
+#include <wspp/server/header_map.hpp>
 
 namespace wspp {
 namespace server {
@@ -24,8 +28,9 @@ namespace detail {
 // Parser for incoming requests.
 class RequestParser{
 public:
-    // Construct ready to parse the request method.
-    RequestParser();
+    // Construct ready to parse the request method. Requests with a body larger than max_body_size (if not 0) are
+    // rejected, uploaded files larger than upload_spool_size (if not 0) are saved in temporary files in upload_dir.
+    RequestParser(uint64_t max_body_size = 0, size_t upload_spool_size = 0, const std::string &upload_dir = std::string());
 
     // Reset to initial parser state.
     void reset();
@@ -33,8 +38,21 @@ public:
     // call the parser with chunk of data while it is in indeterminate state
     boost::tribool parse(const char *data, size_t buf_len);
 
+    // same as above but also returns the number of bytes consumed. Parsing stops at the end of a message so that
+    // any remaining bytes (pipelined requests) may be fed to the parser after reset()
+    boost::tribool parse(const char *data, size_t buf_len, size_t &consumed);
+
+    // true if the connection should be kept open after the response to the parsed message
+    bool keepAlive() const;
+
+    // true once the request line and headers have been received
+    bool headersComplete() const { return headers_complete_; }
+
+    // true if parsing failed because the request body exceeds the maximum size
+    bool bodyTooLarge() const { return body_too_large_; }
+
     // fill in the request structure
-    bool decode_message(Request &req) const;
+    bool decode_message(Request &req);
 
 private:
     static int on_message_begin(http_parser * parser);
@@ -50,8 +68,16 @@ protected:
     http_parser_settings settings_;
 
     std::string current_header_field_, current_header_value_, url_, body_, protocol_;
-    std::map<std::string, std::string> headers_;
-    bool is_complete_;
+    HeaderMap headers_;
+    bool is_complete_, headers_complete_;
+
+    uint64_t max_body_size_, body_size_ = 0;
+    bool body_too_large_ = false;
+
+    // multipart/form-data bodies are decoded while received
+    std::unique_ptr<MultipartParser> multipart_;
+    size_t upload_spool_size_;
+    std::string upload_dir_;
 };
 } // namespace detail
 } // namespace server
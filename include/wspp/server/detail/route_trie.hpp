@@ -0,0 +1,49 @@
+#ifndef __SERVER_ROUTE_TRIE_HPP__
+#define __SERVER_ROUTE_TRIE_HPP__
+
+#include <string>
+#include <vector>
+#include <memory>
+
+#include <boost/noncopyable.hpp>
+
+#include <wspp/util/dictionary.hpp>
+
+namespace wspp {
+namespace server {
+namespace detail {
+
+// Route patterns (see Route) stored in a trie of path segments. Literal segments are children of a node looked up by
+// name, parameters are checked by type (any segment, digits, word characters or a list of alternatives) and only
+// parameters with other regular expressions run one, on their own segment. Matching is read-only and takes no locks.
+class RouteTrie: private boost::noncopyable {
+public:
+    RouteTrie();
+    ~RouteTrie();
+
+    // Add the route with the given id for the methods separated by | (e.g. "GET|POST") and the pattern. Parameters
+    // match a single path segment. Throws std::invalid_argument if the pattern cannot be parsed.
+    void add(const std::string &methods, const std::string &pattern, std::size_t id);
+
+    // Find the route of the method and path, preferring literal segments over parameters and otherwise the routes
+    // added first. On success sets the id of the route and adds its parameters to attributes.
+    bool match(const std::string &method, const std::string &path, std::size_t &id, util::Dictionary &attributes) const;
+
+    // the pattern of the route with the given id as returned by Route::pattern
+    const std::string &pattern(std::size_t id) const { return patterns_[id]; }
+
+private:
+    struct Node;
+    struct Param;
+
+    bool match(const Node &node, const std::vector<std::string> &segments, std::size_t pos, const std::string &method,
+               std::size_t &id, util::Dictionary &attributes) const;
+
+    std::unique_ptr<Node> root_;
+    std::vector<std::string> patterns_;
+};
+
+} // namespace detail
+} // namespace server
+} // namespace wspp
+#endif
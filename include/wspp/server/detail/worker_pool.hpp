@@ -0,0 +1,69 @@
+#ifndef HTTP_SERVER_WORKER_POOL_HPP
+#define HTTP_SERVER_WORKER_POOL_HPP
+
+#include <boost/asio.hpp>
+#include <boost/noncopyable.hpp>
+#include <boost/thread/thread.hpp>
+#include <boost/thread/mutex.hpp>
+
+#include <atomic>
+#include <chrono>
+#include <functional>
+#include <memory>
+
+namespace wspp {
+namespace server {
+namespace detail {
+
+// A pool of threads running request handlers, so that handlers that block (e.g. on database queries) do not stall
+// the I/O threads and the other connections they serve. Tasks wait in a bounded queue; when it is full new tasks
+// are rejected so that the server may shed load instead of queuing requests that will time out anyway.
+class WorkerPool: private boost::noncopyable {
+public:
+    // num_threads workers, at most max_queue tasks waiting for a worker (0 for no limit)
+    WorkerPool(std::size_t num_threads, std::size_t max_queue);
+    ~WorkerPool();
+
+    // Start the worker threads.
+    void start();
+
+    // Stop the workers and wait for them to exit, tasks still queued are discarded.
+    void stop();
+
+    // Queue a task to be run by a worker, returns false if the queue is full. The task is called with false instead
+    // of true if it has been dropped for waiting too long and should only clean up. May be called from any thread.
+    typedef std::function<void (bool run)> Task;
+    bool post(const Task &task);
+
+    // Drop tasks that waited in the queue longer than interval or, if no task waited less than target during the
+    // last interval (i.e. the queue did not drain), longer than target. This is the CoDel variant used for request
+    // queues: short bursts are absorbed, while a standing queue is cut down to target. A 0 interval disables it.
+    void setQueueDelay(std::chrono::milliseconds target, std::chrono::milliseconds interval);
+
+    // number of tasks waiting for a worker
+    std::size_t queued() const { return queued_; }
+
+private:
+    typedef std::chrono::steady_clock Clock;
+
+    // called by a worker about to run a task that was queued for delay
+    bool shouldDrop(Clock::time_point now, Clock::duration delay);
+
+    boost::asio::io_service io_service_;
+    std::unique_ptr<boost::asio::io_service::work> work_;
+    boost::thread_group threads_;
+    std::size_t num_threads_, max_queue_;
+    std::atomic<std::size_t> queued_;
+
+    Clock::duration target_, interval_;
+    // start of the current interval, minimum queueing delay during it and whether the previous one was overloaded
+    Clock::time_point interval_start_;
+    Clock::duration min_delay_;
+    bool overloaded_ = false;
+    boost::mutex mutex_;
+};
+
+} // namespace detail
+} // namespace server
+} // namespace wspp
+#endif
@@ -4,6 +4,9 @@
 #include <vector>
 #include <memory>
 
+#include <boost/asio.hpp>
+#include <boost/asio/spawn.hpp>
+
 #include <wspp/server/filter.hpp>
 
 namespace wspp {
@@ -12,22 +15,44 @@ class Filter;
 class Request;
 class Response;
 class RequestHandler;
+class AsyncRequestHandler;
+
+// The list of filters that a request passes through before reaching the end point.
+// The chain is setup once (add/setEndPoint) and may then be used concurrently by several threads since
+// each call to handle() runs the request with its own cursor. Filters receive this per-request cursor
+// and call next() on it.
 class FilterChain {
 public:
     FilterChain() = default;
+    FilterChain(const FilterChain &) = delete;
+    FilterChain& operator=(const FilterChain&) = delete;
 
     void setEndPoint(RequestHandler *end_point);
     void next(Request &req, Response &resp);
     void add(Filter *);
-    void handle(Request &req, Response &resp);
+    void handle(Request &req, Response &resp) const;
+
+    // Same as above from within a coroutine of io, an AsyncRequestHandler end point then yields instead of blocking.
+    void handle(Request &req, Response &resp, boost::asio::io_service &io, boost::asio::yield_context yield) const;
+
+    // true if the end point is an AsyncRequestHandler
+    bool isAsync() const { return async_end_point_ != nullptr; }
 
 private:
+    // create a cursor pointing to the first filter of the chain
+    explicit FilterChain(const FilterChain *root): root_(root) {}
+
     void doHandle(Request &req, Response &resp);
     typedef std::vector<std::unique_ptr<Filter>> FilterList;
 
     FilterList filters_;
-    FilterList::const_iterator current_;
-    RequestHandler *end_point_;
+    RequestHandler *end_point_ = nullptr;
+    AsyncRequestHandler *async_end_point_ = nullptr;
+
+    const FilterChain *root_ = nullptr;
+    FilterList::size_type current_ = 0;
+    boost::asio::io_service *io_ = nullptr;
+    boost::asio::yield_context *yield_ = nullptr;
 };
 }
 }
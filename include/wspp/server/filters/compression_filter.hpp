@@ -0,0 +1,44 @@
+#ifndef __SERVER_COMPRESSION_FILTER_HPP__
+#define __SERVER_COMPRESSION_FILTER_HPP__
+
+#include <wspp/server/filter.hpp>
+#include <wspp/server/content_encoding.hpp>
+
+#include <memory>
+#include <string>
+
+namespace wspp {
+namespace server {
+class FilterChain;
+class Request;
+class Response;
+namespace detail {
+class FileBody;
+template <class Key, class Value> class LruCache;
+}
+
+// whether a body of the given mime type is worth compressing
+bool content_benefits_from_compression(const std::string &mime);
+
+// Compresses replies with the content coding (see ContentEncodings) preferred by the Accept-Encoding header of the
+// client, including streamed replies as they are produced. Bodies up to fast_size bytes are compressed with the
+// given quality and larger ones with the fastest. The compressed bodies of cacheable replies (with an entity tag)
+// are kept up to cache_size bytes, 0 disables the cache.
+class CompressionFilter: public Filter {
+public:
+    CompressionFilter(ContentEncoding::Quality quality = ContentEncoding::balanced,
+                      std::size_t fast_size = 256 * 1024, std::size_t cache_size = 8 * 1024 * 1024);
+    ~CompressionFilter();
+
+    void handle(Request &req, Response &resp, FilterChain &chain) override;
+
+private:
+    void compressStream(Response &resp, const ContentEncoding &encoding);
+
+    ContentEncoding::Quality quality_;
+    std::size_t fast_size_;
+    std::unique_ptr<detail::LruCache<std::string, std::shared_ptr<detail::FileBody>>> cache_;
+};
+}
+}
+#endif
@@ -0,0 +1,32 @@
+#ifndef __SERVER_METRICS_FILTER_HPP__
+#define __SERVER_METRICS_FILTER_HPP__
+
+#include <wspp/server/filter.hpp>
+#include <wspp/server/metrics.hpp>
+
+namespace wspp {
+namespace server {
+class FilterChain;
+class Request;
+class Response;
+
+// Counts the requests passing through the filter by route pattern (see Request::route_) and status and records the
+// time spent in the rest of the chain, and serves the metrics of the registry in the Prometheus text format at path.
+// It should be added first so that the time of the other filters is included.
+class MetricsFilter: public Filter {
+public:
+    MetricsFilter(MetricsRegistry &registry, const std::string &path = "/metrics");
+
+    void handle(Request &req, Response &resp, FilterChain &chain) override;
+
+private:
+    void record(const Request &req, int status, double seconds);
+
+    MetricsRegistry &registry_;
+    std::string path_;
+    Counter &requests_;
+    Histogram &duration_;
+};
+}
+}
+#endif
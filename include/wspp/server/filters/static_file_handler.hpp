@@ -3,18 +3,34 @@
 
 #include <wspp/server/filter.hpp>
 
+#include <memory>
+
 namespace wspp {
 namespace server {
 class FilterChain;
 class Request;
 class Response;
+namespace detail {
+class AssetCache;
+}
+
+// Serves the files under route_dir, or their precompressed copies (e.g. app.js.br next to app.js) to clients accepting
+// the encoding. Files up to max_cached_file bytes are kept in memory together with their compressed encodings, using
+// at most cache_size bytes, and are checked for modification every ttl seconds. A cache_size of 0 disables caching.
 class StaticFileHandler: public Filter {
 public:
-    StaticFileHandler(const std::string &route_dir): root_(route_dir) {}
+    StaticFileHandler(const std::string &route_dir, std::size_t cache_size = 32 * 1024 * 1024,
+                      std::size_t ttl = 2, std::size_t max_cached_file = 1024 * 1024);
+    ~StaticFileHandler();
 
     void handle(Request &req, Response &resp, FilterChain &chain) override;
 
     std::string root_;
+
+private:
+    void encodeLargeFile(const std::string &path, const std::string &accept_encoding, Response &resp);
+
+    std::unique_ptr<detail::AssetCache> cache_;
 };
 }
 }
@@ -21,17 +21,23 @@ private:
     virtual bool read(Session &session) override;
     std::string uniqueSID() override;
 
+protected:
+    static std::string serializeData(const Dictionary &data);
+    static void deserializeData(const std::string &data, Dictionary &cont);
+
+    // the ts column of sessions, the time they were last stored
+    static uint64_t timestamp();
+
 private:
-    std::string serializeData(const Dictionary &data);
-    void deserializeData(const std::string &data, Dictionary &cont);
 
     bool writeSessionData(const std::string &id, const std::string &data);
-    bool readSessionData(const std::string &id, std::string &data);
+    bool readSessionData(const std::string &id, std::string &data, uint64_t &ts);
 
     bool contains(const std::string &id);
 
     void gc();
 
+protected:
     db::Connection db_;
 };
 } // namespace server
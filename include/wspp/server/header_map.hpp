@@ -0,0 +1,100 @@
+#ifndef __SERVER_HEADER_MAP_HPP__
+#define __SERVER_HEADER_MAP_HPP__
+
+#include <string>
+#include <vector>
+#include <sstream>
+#include <cstdint>
+#include <initializer_list>
+#include <utility>
+
+namespace wspp {
+namespace server {
+
+// Case-insensitive collection of HTTP headers (name/value pairs) kept in insertion order in a flat vector.
+// Well known header names are mapped to a numeric id when added or looked up, so that finding them does not
+// involve string comparisons. Other names are compared case-insensitively.
+// Cleared entries are kept and overwritten by the next headers added, so that a map reused for consecutive
+// messages does not allocate once its strings have grown large enough.
+
+class HeaderMap {
+public:
+    // a header, the name and value are named as in the entries of std::map
+    struct value_type {
+        value_type(std::string name, std::string val, uint8_t id): first(std::move(name)), second(std::move(val)), id_(id) {}
+
+        std::string first, second;
+        uint8_t id_; // id of well known headers or 0
+    };
+    typedef std::vector<value_type>::iterator iterator;
+    typedef std::vector<value_type>::const_iterator const_iterator;
+
+    HeaderMap() = default;
+    HeaderMap(std::initializer_list<std::pair<std::string, std::string>> init);
+
+    // add a header unless one with the same name exists
+    void add(const std::string &name, const std::string &val);
+    // add a header even if one with the same name exists (e.g. Set-Cookie)
+    void append(const std::string &name, const std::string &val);
+    // set the value of a header, adding it if it does not exist
+    void replace(const std::string &name, const std::string &val);
+    // remove all headers with the given name
+    void remove(const std::string &name);
+
+    // check the existance of a header
+    bool contains(const std::string &name) const { return find(name) != end(); }
+
+    // get the value of the given header if exists. Otherwise return defaultVal
+    std::string get(const std::string &name, const std::string &defaultVal = std::string()) const;
+
+    template<class T>
+    T value(const std::string &name, const T &defaultVal) const {
+        const_iterator it = find(name);
+        if ( it == end() ) return defaultVal;
+        std::istringstream strm(it->second);
+        T res;
+        strm >> res;
+        if ( strm.fail() ) return defaultVal;
+        else return res;
+    }
+
+    // value of the header, it is added with an empty value if it does not exist
+    std::string &operator[] (const std::string &name);
+
+    // first header with the given name or end()
+    iterator find(const std::string &name);
+    const_iterator find(const std::string &name) const;
+
+    iterator begin() { return headers_.begin(); }
+    iterator end() { return headers_.begin() + size_; }
+    const_iterator begin() const { return headers_.begin(); }
+    const_iterator end() const { return headers_.begin() + size_; }
+
+    size_t size() const { return size_; }
+    bool empty() const { return size_ == 0; }
+    // remove all headers keeping their storage for reuse
+    void clear() { size_ = 0; }
+
+    void swap(HeaderMap &other) {
+        headers_.swap(other.headers_);
+        std::swap(size_, other.size_);
+    }
+
+    // id of a well known header name or 0
+    static uint8_t id(const char *name, size_t len);
+
+private:
+    size_t indexOf(const char *name, size_t len) const;
+
+    // typical number of headers of a message
+    static const size_t initial_capacity = 16;
+
+    // headers_[0, size_) are in use, the rest are cleared entries
+    std::vector<value_type> headers_;
+    size_t size_ = 0;
+};
+
+} // namespace server
+} // namespace wspp
+
+#endif
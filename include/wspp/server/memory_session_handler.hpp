@@ -0,0 +1,94 @@
+#ifndef __WSPP_SERVER_MEMORY_SESSION_HANDLER_HPP__
+#define __WSPP_SERVER_MEMORY_SESSION_HANDLER_HPP__
+
+#include <wspp/server/fs_session_handler.hpp>
+
+#include <boost/asio.hpp>
+#include <boost/thread/thread.hpp>
+#include <boost/thread/mutex.hpp>
+
+#include <chrono>
+#include <list>
+#include <memory>
+#include <string>
+#include <unordered_map>
+
+namespace wspp {
+namespace server {
+
+// Session data kept in memory and written back to SQLite (see FileSystemSessionHandler) in the background, so that
+// requests of an active session neither query nor write the database. Sessions are kept in shards locked separately,
+// the least recently used are evicted when they take more than max_memory bytes and read back from the database when
+// needed. Changed sessions are written in one transaction every flush_interval and sessions not used for ttl expire,
+// in memory as well as in the database. Pending changes are written when the handler is destroyed.
+class MemorySessionHandler: public FileSystemSessionHandler {
+public:
+    MemorySessionHandler(const std::string &db_file = std::string(), std::size_t max_memory = 64 * 1024 * 1024,
+                         std::chrono::seconds ttl = std::chrono::minutes(60),
+                         std::chrono::milliseconds flush_interval = std::chrono::seconds(5));
+    ~MemorySessionHandler();
+
+    // write the changed sessions to the database now
+    void flush();
+
+    // remove the sessions not used for ttl
+    void expire();
+
+    // number of sessions in memory and their size in bytes
+    std::size_t size() const;
+    std::size_t memory() const;
+
+private:
+    bool write(const Session &session) override;
+    bool read(Session &session) override;
+    std::string uniqueSID() override;
+
+    typedef std::chrono::steady_clock Clock;
+
+    struct Entry {
+        Dictionary data_;
+        std::size_t cost_ = 0;
+        Clock::time_point accessed_;
+        // incremented by every change, the data is dirty while it differs from the version in the database
+        uint64_t version_ = 0, stored_version_ = 0;
+        // when the session was last stored (the ts column of the database), refreshed if it is used for long
+        uint64_t stored_ts_ = 0;
+        std::list<std::string>::iterator lru_;
+    };
+
+    struct Shard {
+        mutable boost::mutex mutex_;
+        std::unordered_map<std::string, Entry> entries_;
+        // evicted sessions with changes not yet written, until the next flush
+        std::unordered_map<std::string, Entry> evicted_;
+        // from the most to the least recently used
+        std::list<std::string> lru_;
+        std::size_t cost_ = 0;
+    };
+
+    static const std::size_t num_shards = 16;
+
+    Shard &shard(const std::string &sid);
+    Entry &insert(Shard &shard, const std::string &sid, Entry &&entry);
+    Entry *find(Shard &shard, const std::string &sid);
+    void evict(Shard &shard);
+    bool load(const std::string &sid, Dictionary &data, uint64_t &ts);
+    void schedule();
+
+    std::size_t max_shard_memory_;
+    std::chrono::seconds ttl_;
+    std::chrono::milliseconds flush_interval_;
+    Shard shards_[num_shards];
+
+    // serializes the use of the database connection
+    boost::mutex db_mutex_;
+
+    // writes back and expires sessions
+    boost::asio::io_service io_service_;
+    boost::asio::steady_timer timer_;
+    Clock::time_point last_expiry_;
+    boost::thread thread_;
+};
+} // namespace server
+} // namespace wspp
+#endif
@@ -0,0 +1,158 @@
+#ifndef __SERVER_METRICS_HPP__
+#define __SERVER_METRICS_HPP__
+
+#include <string>
+#include <vector>
+#include <map>
+#include <memory>
+#include <atomic>
+#include <functional>
+#include <ostream>
+
+#include <boost/noncopyable.hpp>
+#include <boost/thread/mutex.hpp>
+
+namespace wspp {
+namespace server {
+
+// Values of the labels of a series, in the order of the label names given to the metric
+typedef std::vector<std::string> MetricLabels;
+
+namespace detail {
+// The series of a metric updated by each thread. A thread only ever updates its own series, so that updates need
+// no locks and do not contend; the series of all threads are summed when the metrics are scraped.
+template <class Series>
+class ThreadSeries {
+public:
+    ThreadSeries();
+
+    // the series of the calling thread with the given (encoded) labels
+    Series &local(const std::string &key);
+
+    // call f(key, series) for each series of each thread
+    template <class F> void forEach(F f) const;
+
+private:
+    struct Shard {
+        std::map<std::string, std::unique_ptr<Series>> series_;
+        // held by the owner thread while adding series and by scrapes while reading them
+        mutable boost::mutex mutex_;
+    };
+
+    Shard &localShard();
+
+    // unique among all instances, used to find the shard of the calling thread
+    std::size_t id_;
+    std::vector<std::unique_ptr<Shard>> shards_;
+    mutable boost::mutex mutex_;
+};
+
+struct CounterSeries {
+    std::atomic<uint64_t> value_{0};
+};
+
+// Log-linear buckets in the manner of HDR histograms: values (in microseconds) up to 16 have a bucket each and
+// every following power of two is split into 8 buckets, so that values are recorded within 12.5% up to days.
+struct HistogramSeries {
+    static const std::size_t num_buckets = 16 + 8 * 37;
+
+    static std::size_t bucket(uint64_t value);
+    // smallest value of the next bucket
+    static uint64_t upperBound(std::size_t bucket);
+
+    std::atomic<uint64_t> buckets_[num_buckets];
+    std::atomic<uint64_t> count_{0}, sum_{0};
+
+    HistogramSeries();
+};
+} // namespace detail
+
+// A metric of the registry, written in the Prometheus text format when scraped
+class Metric: private boost::noncopyable {
+public:
+    Metric(const std::string &name, const std::string &help, const std::string &type,
+           const std::vector<std::string> &label_names);
+    virtual ~Metric() = default;
+
+    void write(std::ostream &strm) const;
+
+protected:
+    virtual void writeSeries(std::ostream &strm) const = 0;
+
+    // key of the series with the given label values
+    static std::string key(const MetricLabels &labels);
+    // label list (e.g. {route="/",status="200"}) of the series with the given key, extra is appended if not empty
+    std::string labels(const std::string &key, const std::string &extra = std::string()) const;
+
+    std::string name_, help_, type_;
+    std::vector<std::string> label_names_;
+};
+
+// A monotonically increasing count (e.g. of requests or bytes)
+class Counter: public Metric {
+public:
+    Counter(const std::string &name, const std::string &help, const std::vector<std::string> &label_names);
+
+    void inc(const MetricLabels &labels = MetricLabels(), uint64_t n = 1);
+
+private:
+    void writeSeries(std::ostream &strm) const override;
+
+    mutable detail::ThreadSeries<detail::CounterSeries> series_;
+};
+
+// Distribution of durations (e.g. of request handling), exposed as a Prometheus histogram in seconds
+class Histogram: public Metric {
+public:
+    Histogram(const std::string &name, const std::string &help, const std::vector<std::string> &label_names);
+
+    void observe(const MetricLabels &labels, double seconds);
+
+private:
+    void writeSeries(std::ostream &strm) const override;
+
+    mutable detail::ThreadSeries<detail::HistogramSeries> series_;
+};
+
+// A metric whose single value is read when it is scraped (e.g. the number of open connections)
+class SampledMetric: public Metric {
+public:
+    SampledMetric(const std::string &name, const std::string &help, const std::string &type,
+                  const std::function<double ()> &sample);
+
+private:
+    void writeSeries(std::ostream &strm) const override;
+
+    std::function<double ()> sample_;
+};
+
+// Holds the metrics of the application and writes them in the Prometheus text exposition format.
+// Metrics are created once at startup and may then be updated from any thread.
+class MetricsRegistry: private boost::noncopyable {
+public:
+    MetricsRegistry() = default;
+
+    Counter &counter(const std::string &name, const std::string &help,
+                     const std::vector<std::string> &label_names = std::vector<std::string>());
+
+    Histogram &histogram(const std::string &name, const std::string &help,
+                         const std::vector<std::string> &label_names = std::vector<std::string>());
+
+    // a gauge (or counter) whose value is kept elsewhere and read by sample when scraped
+    void sampledGauge(const std::string &name, const std::string &help, const std::function<double ()> &sample);
+    void sampledCounter(const std::string &name, const std::string &help, const std::function<double ()> &sample);
+
+    // write all metrics
+    void write(std::ostream &strm) const;
+    std::string scrape() const;
+
+private:
+    template <class M> M &add(M *metric);
+
+    std::vector<std::unique_ptr<Metric>> metrics_;
+    mutable boost::mutex mutex_;
+};
+
+} // namespace server
+} // namespace wspp
+#endif
@@ -6,6 +6,7 @@
 
 #include <wspp/util/dictionary.hpp>
 #include <wspp/server/route.hpp>
+#include <wspp/server/header_map.hpp>
 
 namespace wspp {
 namespace server {
@@ -21,18 +22,21 @@ public:
 
     bool supportsGzip();
 
+    // reset to an empty request, keeping allocated memory for the next request on the same connection
+    void clear();
+
 public:
-    Dictionary SERVER_; // Server variables
+    HeaderMap SERVER_;  // Request headers and server variables (case-insensitive)
     Dictionary GET_;	 // Query variables for GET requests
     Dictionary POST_;   // Post variables for POST requests
     Dictionary COOKIE_; // Cookies
 
     struct UploadedFile {
         std::string name_;	// The original filename
-        std::string path_; // The path of a local temporary copy of the uploaded file
+        std::string path_; // The path of a local temporary copy of the uploaded file, it is deleted after the response is sent
         std::string mime_;	// MIME information of the uploaded file
         size_t size_;
-        std::string data_; // This member variable contains the file contents for small files
+        std::string data_; // This member variable contains the file contents for small files (when path_ is empty)
     };
 
     std::map<std::string, UploadedFile> FILE_;	// Uploaded files
@@ -48,8 +52,12 @@ public:
     std::string query_;
     std::string protocol_;
 
+    // pattern of the route matched by the handler (see matches), or empty. Used to label metrics by route.
+    mutable std::string route_;
+
 private:
     bool matchesMethod(const std::string &method) const;
+    bool matchesRoute(const Route &route, Dictionary &attributes) const;
     std::string getCleanPath(const std::string &path) const;
 };
 } // namespace server
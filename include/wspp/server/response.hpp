@@ -3,8 +3,12 @@
 
 #include <string>
 #include <vector>
+#include <memory>
+#include <functional>
+#include <ostream>
 
 #include <wspp/util/dictionary.hpp>
+#include <wspp/server/header_map.hpp>
 #include <wspp/util/variant.hpp>
 #include <wspp/util/i18n.hpp>
 
@@ -12,6 +16,10 @@ namespace wspp {
 namespace server {
 using util::Variant;
 using util::Dictionary;
+class Request;
+namespace detail {
+class FileBody;
+}
 // A reply to be sent to a client.
 struct Response {
     // The status of the reply.
@@ -20,6 +28,7 @@ struct Response {
         created = 201,
         accepted = 202,
         no_content = 204,
+        partial_content = 206,
         multiple_choices = 300,
         moved_permanently = 301,
         moved_temporarily = 302,
@@ -28,6 +37,8 @@ struct Response {
         unauthorized = 401,
         forbidden = 403,
         not_found = 404,
+        payload_too_large = 413,
+        range_not_satisfiable = 416,
         internal_server_error = 500,
         not_implemented = 501,
         bad_gateway = 502,
@@ -35,14 +46,38 @@ struct Response {
     } status_ = not_found;
 
     // The headers to be included in the reply.
-    Dictionary headers_;
+    HeaderMap headers_;
 
     // The content to be sent in the reply.
     std::string content_;
 
+    // If set, the body of the reply is sent directly from this file (see encodeFile) and content_ is ignored.
+    std::shared_ptr<detail::FileBody> file_;
+
+    // A range of bytes of file_ preceded in the body by prefix_ (the headers of a part of a multipart/byteranges body)
+    struct FileRange {
+        uint64_t offset_, length_;
+        std::string prefix_;
+    };
+
+    // If not empty, only these ranges of file_ are sent, followed by ranges_suffix_ (see sendRanges).
+    std::vector<FileRange> ranges_;
+    std::string ranges_suffix_;
+
+    // Producer of the body of a streamed reply. It is called after the headers have been sent and then every time the
+    // previous piece of the body has been written to the socket. Each call should write the next piece to the stream
+    // and return false when the body is complete. It runs after the handler has returned so it should own its data.
+    typedef std::function<bool (std::ostream &strm)> ContentGenerator;
+
+    // If set, the body of the reply is produced by this generator (see stream) and content_ is ignored.
+    ContentGenerator generator_;
+
     // Get a stock reply.
     void stockReply(Status status);
 
+    // reset to an empty reply, keeping allocated memory for the next reply on the same connection
+    void clear();
+
     // This will correctly fill in the reply headers for sending over a file payload. It will also set status to OK.
     // If encoding is empty it will try to guess from the payload (gzip only supported)
 
@@ -52,7 +87,8 @@ struct Response {
                      const time_t mod_time
                      );
 
-    // This will load the file given its path name and call encode_file_data above.
+    // This will fill in the reply headers for the file given its path name and send the file contents
+    // without loading it to memory (see file_).
     // If no mime is provided it will try to guess from the file extension
 
     void encodeFile(const std::string &path_name,
@@ -60,6 +96,32 @@ struct Response {
                      const std::string &mime = std::string()
                      );
 
+    // Same as above for an opened (or cached, see FileBody::fromMemory) file with the given encoding and mime
+    void encodeFile(const std::shared_ptr<detail::FileBody> &file, const std::string &encoding, const std::string &mime);
+
+    // mime type of a file guessed from its extension
+    static std::string fileMimeType(const std::string &path);
+
+    // Set the validators of the reply, the ETag header and, if not zero, the Last-Modified header, and call
+    // notModified. Handlers of cacheable content may call it before producing the body and return at once
+    // if it returns true.
+    bool checkNotModified(const Request &req, const std::string &etag, time_t last_modified = 0);
+
+    // If the reply has validators (see checkNotModified) matching the If-None-Match or else the If-Modified-Since
+    // header of a GET or HEAD request, turn it into 304 Not Modified without a body and return true.
+    // Replies of encodeFile and encodeFileData have validators.
+    bool notModified(const Request &req);
+
+    // Restrict a reply of encodeFile or encodeFileData to the byte ranges of the Range header of a GET request,
+    // unless an If-Range header does not match the validators of the reply. Overlapping and adjacent ranges are
+    // merged. The reply becomes 206 Partial Content with a multipart/byteranges body if several ranges remain, or 416
+    // Range Not Satisfiable if none of them is within the body. File bodies are not read, only the requested bytes
+    // are sent. Returns true if the reply was changed.
+    bool sendRanges(const Request &req);
+
+    // quoted entity tag derived from a hash of the content, weak if the content may change representation
+    static std::string entityTag(const std::string &content, bool weak = false);
+
     // Calls write() appropriately setting the content type
     void writeJSON(const std::string &json);
     // Same as above taking as input a Variant converted to JSON string
@@ -71,6 +133,11 @@ struct Response {
     // This should be used for incrementally outputting text. Content type and length have to provided afterwards
     void append(const std::string &content);
 
+    // Send the body produced by the generator while the client consumes it, so that the whole body is never kept
+    // in memory. Unless a Content-Length header is set, the body is sent with chunked transfer encoding to HTTP/1.1
+    // clients and is delimited by closing the connection for HTTP/1.0 clients. It will also set status to OK.
+    void stream(const ContentGenerator &generator, const std::string &mime = "text/html");
+
     // helper for appending arbitrary streamable types
     template <class T>
     void append(const T &t) {
@@ -95,6 +162,13 @@ struct Response {
 
     // set output status
     void setStatus(Status st) { status_ = st; }
+
+    // size of the body of the reply (not known for streamed replies)
+    uint64_t contentLength() const;
+
+private:
+    void encodeFileHeaders(uint64_t size, const std::string &encoding, const std::string &mime, const time_t mod_time,
+                           const std::string &etag);
 };
 } // namespace server
 } // namespace wspp
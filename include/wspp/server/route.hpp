@@ -25,6 +25,9 @@ public:
     bool matches(const std::string &path, Dictionary &data) const;
     bool matches(const std::string &path) const;
 
+    // the pattern of the route (with a trailing slash)
+    const std::string &pattern() const;
+
     // generate a url from the given route replacing parameters
     std::string url(const Dictionary &params, bool relative = true) const ;
 
@@ -2,19 +2,58 @@
 #define __WSPP_ROUTER_HPP__
 
 #include <wspp/server/request.hpp>
-#include <wspp/server/response.hpp>
-#include <wspp/server/request_handler.hpp>
+#include <wspp/server/detail/route_trie.hpp>
 
-#include <functional>
-#include <boost/regex.hpp>
+#include <initializer_list>
+#include <vector>
 
 namespace wspp {
 namespace server {
+
+// Finds the handler of a request among routes given by a method and a pattern (see Route), e.g.
+//
+//     typedef void (*Action)(MyController &c, const Dictionary &attributes);
+//     static const Router<Action> routes {
+//         { "GET", "/page/{id:\\d+}/", [] (MyController &c, const Dictionary &a) { c.show(a.get("id")); } },
+//         ...
+//     };
+//
+// The routes are kept in a trie of path segments (see detail::RouteTrie) so that the cost of a lookup depends on the
+// length of the path rather than the number of routes, and no regular expression runs unless a parameter needs one.
+// A router is built once and may then be used from any thread without locking.
+template <class Handler>
 class Router {
 public:
+    struct Entry {
+        std::string methods_, pattern_;
+        Handler handler_;
+    };
+
     Router() {}
-    void addHandler();
+    Router(std::initializer_list<Entry> entries) {
+        for( const Entry &e: entries )
+            add(e.methods_, e.pattern_, e.handler_);
+    }
+
+    // add a route for the methods separated by | (e.g. "GET|POST") and the pattern
+    void add(const std::string &methods, const std::string &pattern, const Handler &handler) {
+        trie_.add(methods, pattern, handlers_.size());
+        handlers_.push_back(handler);
+    }
+
+    // The handler of the route of the request or null. If found the parameters of the route are added to attributes
+    // and the route_ of the request is set (see Request::matches).
+    const Handler *match(const Request &req, Dictionary &attributes) const {
+        std::size_t id;
+        if ( !trie_.match(req.method_, req.path_, id, attributes) ) return nullptr;
+
+        req.route_ = trie_.pattern(id);
+        return &handlers_[id];
+    }
+
 private:
+    detail::RouteTrie trie_;
+    std::vector<Handler> handlers_;
 };
 } // namespace server
 } // namespace wspp
@@ -21,6 +21,9 @@
 #include <wspp/server/detail/connection.hpp>
 #include <wspp/server/detail/io_service_pool.hpp>
 #include <wspp/server/detail/connection_manager.hpp>
+#include <wspp/server/detail/connection_pool.hpp>
+#include <wspp/server/detail/admission_control.hpp>
+#include <wspp/server/metrics.hpp>
 
 namespace wspp { namespace server {
 // The top-level class of the HTTP server.
@@ -28,8 +31,11 @@ class Server {
 public:
     // Construct the server to listen on the specified TCP address and port, and
     // serve up files from the given directory.
+    // If reuse_port is true every thread of the pool listens on the port with its own acceptor (SO_REUSEPORT),
+    // and serves the connections it accepts, letting the kernel balance connections among threads.
+    // Otherwise a single acceptor hands over connections to the threads of the pool in round-robin.
     explicit Server(const std::string& address, const std::string& port,
-                    std::size_t io_service_pool_size = 4);
+                    std::size_t io_service_pool_size = 4, bool reuse_port = false);
 
     // intercept filter/middleware to the service chain
     void addFilter(Filter *filter);
@@ -37,37 +43,132 @@ public:
     // set request handler for this service
     void setHandler(RequestHandler *handler);
 
+    // set the idle timeout (in seconds) of persistent connections and the maximum number of requests
+    // served over each of them. Setting max_requests to 0 closes the connection after every response.
+    void setKeepAlive(std::size_t timeout, std::size_t max_requests);
+
+    // set the time (in seconds) allowed to receive the headers of a request, to wait for each piece of a request
+    // body and to send each piece of a response. Connections not making progress in time are closed. 0 disables
+    // a timeout.
+    void setTimeouts(std::size_t header_timeout, std::size_t body_timeout, std::size_t write_timeout);
+
+    // set the maximum number of concurrent connections from a single remote address (0 for no limit).
+    // Further connections from the address are closed immediately.
+    void setMaxConnectionsPerAddress(std::size_t max_connections) {
+        connection_options_.max_connections_per_address_ = max_connections;
+    }
+
+    // set the maximum number of concurrent connections (0 for no limit). Further connections get a 503 (Service
+    // Unavailable) response and are closed once the client has read it, their request is discarded.
+    void setMaxConnections(std::size_t max_connections) { max_connections_ = max_connections; }
+
+    // set the maximum number of requests being handled, or waiting for a worker, at once (0 for no limit).
+    // Further requests get a 503 response without running the handler.
+    void setMaxInFlightRequests(std::size_t max_requests) {
+        connection_options_.max_in_flight_requests_ = max_requests;
+    }
+
+    // set the maximum size in bytes of request bodies (0 for no limit). Larger requests get a 413 response.
+    void setMaxBodySize(uint64_t max_body_size) { connection_options_.max_body_size_ = max_body_size; }
+
+    // uploaded files larger than spool_size bytes are saved in temporary files in folder (the system temporary
+    // folder if empty) instead of memory. Setting spool_size to 0 keeps all uploads in memory.
+    void setUploadSpooling(std::size_t spool_size, const std::string &folder = std::string());
+
+    // run handlers on a pool of num_threads worker threads instead of the I/O threads, so that handlers that block
+    // do not delay the other connections. If max_queue requests (0 for no limit) are already waiting for a worker,
+    // further requests get a 503 (Service Unavailable) response.
+    void setWorkerPool(std::size_t num_threads, std::size_t max_queue);
+
+    // requests that waited for a worker longer than interval milliseconds get a 503 response instead of running the
+    // handler, and so do those waiting longer than target milliseconds once the queue has not drained below target
+    // for a whole interval. An interval of 0 (the default) disables dropping. See WorkerPool::setQueueDelay.
+    void setQueueDelay(std::size_t target, std::size_t interval);
+
+    // current load and counts of accepted and turned down connections and requests
+    ServerStats stats() const;
+
+    // record the traffic and write times of connections and the counters of stats() in registry, which must
+    // outlive the server. Add a MetricsFilter to record requests by route and serve the metrics.
+    void setMetrics(MetricsRegistry &registry);
+
+    // bind each thread of the pool to a separate CPU
+    void setCpuAffinity(bool pin_threads) { pin_threads_ = pin_threads; }
+
+    // The port the server listens on, the one chosen by the system if constructed with port "0". The server accepts
+    // connections once constructed, they are served when run() is called.
+    unsigned short port() const;
+
     // Run the server's io_service loop.
     void run();
 
-    // Stop server loop
+    // Stop server loop. It may be called from any thread.
     void stop();
 
 private:
-    // Initiate an asynchronous accept operation.
-    void start_accept();
+    // An acceptor together with the connections it has accepted
+    struct Listener {
+        Listener(boost::asio::io_service &io, std::size_t num_shards): acceptor_(io), connection_manager_(num_shards) {}
 
-    // Handle completion of an asynchronous accept operation.
-    void handle_accept(const boost::system::error_code& e);
+        // Acceptor used to listen for incoming connections.
+        boost::asio::ip::tcp::acceptor acceptor_;
+
+        ConnectionManager connection_manager_;
+
+        // The next connection to be accepted and the index of the io_service it runs on
+        ConnectionPtr new_connection_;
+        std::size_t new_connection_index_ = 0;
+
+        // The io_service serving accepted connections (and its index in the pool) or null to use the whole pool
+        boost::asio::io_service *io_service_;
+        std::size_t io_service_index_ = 0;
+    };
+
+    // Initiate an asynchronous accept operation.
+    void start_accept(Listener &listener);
 
     // Handle a request to stop the server.
     void handle_stop();
 
+    // Close the acceptors and connections running on the io_service of the pool with the given index, from its thread
+    void stop_io_service(std::size_t index);
+
     void do_await_stop();
 
+    // Refresh the cached Date header every second
+    void update_date();
+
+    // Open connections of each remote address, it outlives the connections destroyed with the pool
+    ConnectionsPerAddress connections_per_address_;
+
+    // Open connections and requests in flight, it also outlives the connections
+    detail::AdmissionControl admission_;
+    std::size_t max_connections_ = 0;
+
+    // Metrics recorded by the connections, if set
+    std::unique_ptr<ConnectionMetrics> connection_metrics_;
+
     // The pool of io_service objects used to perform asynchronous operations.
     detail::io_service_pool io_service_pool_;
 
     // The signal_set is used to register for process termination notifications.
     boost::asio::signal_set signals_;
 
-    // Acceptor used to listen for incoming connections.
-    boost::asio::ip::tcp::acceptor acceptor_;
+    // Timer refreshing the Date header of responses
+    boost::asio::steady_timer date_timer_;
+
+    // Unused connection objects for each io_service of the pool
+    std::shared_ptr<detail::ConnectionPool> connection_pool_;
+
+    // Threads running the handlers, if not set handlers run on the I/O threads
+    std::unique_ptr<detail::WorkerPool> worker_pool_;
+    std::size_t queue_target_ = 0, queue_interval_ = 0;
+
+    std::vector<std::unique_ptr<Listener>> listeners_;
 
-    ConnectionManager connection_manager_;
+    ConnectionOptions connection_options_;
 
-     // The next socket to be accepted.
-    boost::asio::ip::tcp::socket socket_;
+    bool pin_threads_ = false;
 
     std::unique_ptr<RequestHandler> handler_;
     FilterChain filters_;
@@ -26,6 +26,8 @@ public:
 private:
     std::string id_;
     Dictionary data_;
+    // the data as read by the handler, the session is only written if it was changed
+    Dictionary stored_;
     uint64_t lifetime_;
     SessionHandler &handler_;
 };
@@ -5,7 +5,7 @@
 #include <wspp/server/request_handler.hpp>
 #include <wspp/server/response.hpp>
 #include <wspp/server/request.hpp>
-#include <wspp/server/fs_session_handler.hpp>
+#include <wspp/server/memory_session_handler.hpp>
 #include <wspp/server/session.hpp>
 #include <wspp/server/server.hpp>
 
@@ -36,7 +36,8 @@
 #include <wspp/server/route.hpp>
 #include <wspp/server/filters/request_logger.hpp>
 #include <wspp/server/filters/static_file_handler.hpp>
-#include <wspp/server/filters/gzip_filter.hpp>
+#include <wspp/server/filters/compression_filter.hpp>
+#include <wspp/server/filters/metrics_filter.hpp>
 
 #include <spatialite.h>
 #include <wspp/util/i18n.hpp>
@@ -134,6 +135,9 @@ public:
         fs::path p(root_ + req.path_);
         if ( fs::exists(p) && fs::is_regular_file(p) ) {
             resp.encodeFile(p.string());
+            // PDF viewers fetch attachments in ranges and interrupted downloads are resumed
+            if ( !resp.notModified(req) )
+                resp.sendRanges(req);
             return;
         }
 
@@ -161,7 +165,8 @@ int main(int argc, char *argv[]) {
 
     Server server("127.0.0.1", "5000");
 
-    FileSystemSessionHandler sh;
+    // sessions are served from memory and written back to SQLite in the background
+    MemorySessionHandler sh;
     DefaultLogger logger("/tmp/logger", true);
 
     const string root = "/mnt/e/Dev/network/wsrv/data/routes/";
@@ -169,8 +174,18 @@ int main(int argc, char *argv[]) {
 
     server.setHandler(service);
 
+    // database queries and template rendering block, keep them off the I/O threads
+    server.setWorkerPool(8, 256);
+    // under overload answer 503 quickly rather than serve requests their clients gave up on
+    server.setQueueDelay(100, 1000);
+    server.setMaxConnections(4096);
+
+    static MetricsRegistry metrics;
+    server.setMetrics(metrics);
+
+    server.addFilter(new MetricsFilter(metrics));
     server.addFilter(new RequestLoggerFilter(logger));
-    server.addFilter(new GZipFilter());
+    server.addFilter(new CompressionFilter());
 
     server.run();
 }
\ No newline at end of file
@@ -5,17 +5,13 @@
 
 #include <wspp/views/table.hpp>
 #include <wspp/server/exceptions.hpp>
+#include <wspp/server/router.hpp>
 
 using namespace std;
 using namespace wspp::util;
 using namespace wspp::web;
 using namespace wspp::server;
 
-static Route route_list("/attachments/{id:\\d+}/list");
-static Route route_add("/attachments/{id:\\d+}/add");
-static Route route_update("/attachments/{id:\\d+}/update");
-static Route route_delete("/attachments/{id:\\d+}/delete");
-
 AttachmentCreateForm::AttachmentCreateForm(const Request &req, RouteModel &routes, const string &route_id,
                                            const string &upload_folder):
     request_(req), routes_(routes), upload_folder_(upload_folder), route_id_(route_id) {
@@ -31,7 +27,7 @@ AttachmentCreateForm::AttachmentCreateForm(const Request &req, RouteModel &route
 void AttachmentCreateForm::onSuccess(const Request &request){
    auto it = request.FILE_.find("attachment-file");
 
-   routes_.createAttachment(route_id_, it->second.name_, getValue("type"), it->second.data_, upload_folder_);
+   routes_.createAttachment(route_id_, it->second.name_, getValue("type"), it->second.data_, it->second.path_, upload_folder_);
 }
 
 AttachmentUpdateForm::AttachmentUpdateForm(RouteModel &routes, const string &route_id):
@@ -99,34 +95,21 @@ void AttachmentController::remove(const std::string &route_id){
 }
 
 bool AttachmentController::dispatch(){
-    Dictionary attributes;
+    typedef void (*Action)(AttachmentController &c, const Dictionary &attributes);
 
-    bool logged_in = user_.check();
-    if ( request_.matches("GET", route_list, attributes) ) {
-        if ( logged_in ) list(attributes.get("id"));
-        else throw HttpResponseException(Response::unauthorized);
-        return true;
-    }
+    static const Router<Action> routes {
+        { "GET", "/attachments/{id:\\d+}/list", [] (AttachmentController &c, const Dictionary &a) { c.user_.require(); c.list(a.get("id")); } },
+        { "GET|POST", "/attachments/{id:\\d+}/add", [] (AttachmentController &c, const Dictionary &a) { c.user_.require(); c.create(a.get("id")); } },
+        { "GET|POST", "/attachments/{id:\\d+}/update", [] (AttachmentController &c, const Dictionary &a) { c.user_.require(); c.update(a.get("id")); } },
+        { "POST", "/attachments/{id:\\d+}/delete", [] (AttachmentController &c, const Dictionary &a) { c.user_.require(); c.remove(a.get("id")); } }
+    };
 
-    if ( request_.matches("GET|POST", route_add, attributes) ) {
-        if ( logged_in ) create(attributes.get("id"));
-        else throw HttpResponseException(Response::unauthorized);
-        return true;
-    }
+    Dictionary attributes;
+    const Action *action = routes.match(request_, attributes);
+    if ( !action ) return false;
 
-    if ( request_.matches("GET|POST", route_update, attributes) ) {
-        if ( logged_in ) update(attributes.get("id"));
-        else throw HttpResponseException(Response::unauthorized);
-        return true;
-    } else if ( request_.matches("POST", route_delete, attributes) ) {
-        if ( logged_in )
-            remove(attributes.get("id"));
-        else
-            throw HttpResponseException(Response::unauthorized);
-        return true;
-    } else {
-        return false;
-    }
+    (*action)(*this, attributes);
+    return true;
 }
 
 void AttachmentController::list(const std::string &route_id){
@@ -1,5 +1,6 @@
 #include "auth.hpp"
 #include <wspp/util/crypto.hpp>
+#include <wspp/server/exceptions.hpp>
 
 #include <boost/algorithm/string.hpp>
 #include <boost/regex.hpp>
@@ -202,6 +203,11 @@ bool User::can(const string &action) const {
     return false;
 }
 
+void User::require(const string &action) const {
+    if ( !check() || ( !action.empty() && !can(action) ) )
+        throw wspp::server::HttpResponseException(wspp::server::Response::unauthorized);
+}
+
 static string strip_all_tags(const string &str, bool remove_breaks = false) {
     static boost::regex rx_stags(R"(<(script|style)[^>]*?>.*?<\/\1>)", boost::regex::icase);
     static boost::regex rx_tags(R"(<[^>]*>)");
@@ -49,6 +49,9 @@ public:
     // test if the user has permission to perform the action
     bool can(const std::string &action) const;
 
+    // throw 401 Unauthorized unless the user is logged in and, if an action is given, may perform it
+    void require(const std::string &action = std::string()) const;
+
     AuthorizationModel &auth() const { return auth_; }
 
     static std::string sanitizeUserName(const std::string &username);
@@ -5,6 +5,7 @@
 
 #include <wspp/views/forms.hpp>
 #include <wspp/server/exceptions.hpp>
+#include <wspp/server/router.hpp>
 
 #include <boost/algorithm/string.hpp>
 #include <boost/regex.hpp>
@@ -81,9 +82,18 @@ void LoginForm::onSuccess(const Request &request) {
 }
 
 bool LoginController::dispatch(){
-    if ( request_.matches("GET|POST", "/user/login/") ) login();
-    else if ( request_.matches("POST", "/user/logout/") ) logout();
-    else return false;
+    typedef void (LoginController::*Action)();
+
+    static const Router<Action> routes {
+        { "GET|POST", "/user/login/", &LoginController::login },
+        { "POST", "/user/logout/", &LoginController::logout }
+    };
+
+    Dictionary attributes;
+    const Action *action = routes.match(request_, attributes);
+    if ( !action ) return false;
+
+    (this->*(*action))();
     return true;
 }
 
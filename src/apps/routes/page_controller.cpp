@@ -5,6 +5,7 @@
 
 #include <wspp/views/table.hpp>
 #include <wspp/server/exceptions.hpp>
+#include <wspp/server/router.hpp>
 
 using namespace std;
 using namespace wspp::util;
@@ -134,50 +135,27 @@ void PageController::remove(){
 }
 
 bool PageController::dispatch(){
-    if ( !boost::starts_with(request_.path_, "/page") )
-        return false;
+    typedef void (*Action)(PageController &c, const Dictionary &attributes);
+
+    static const Router<Action> routes {
+        // load page list editor
+        { "GET", "/pages/edit/", [] (PageController &c, const Dictionary &) { c.user_.require("pages.edit"); c.edit(); } },
+        // fetch table data
+        { "GET", "/pages/list/", [] (PageController &c, const Dictionary &) { c.user_.require(); c.fetch(); } },
+        { "GET|POST", "/pages/add/", [] (PageController &c, const Dictionary &) { c.user_.require(); c.create(); } },
+        { "GET|POST", "/pages/update/", [] (PageController &c, const Dictionary &) { c.user_.require(); c.update(); } },
+        { "GET", "/page/edit/{id}/", [] (PageController &c, const Dictionary &a) { c.user_.require(); c.edit(a.get("id")); } },
+        { "POST", "/page/publish/", [] (PageController &c, const Dictionary &) { c.user_.require(); c.publish(); } },
+        { "POST", "/pages/delete/", [] (PageController &c, const Dictionary &) { c.user_.require(); c.remove(); } },
+        { "GET", "/page/{id}/", [] (PageController &c, const Dictionary &a) { c.show(a.get("id")); } }
+    };
 
     Dictionary attributes;
+    const Action *action = routes.match(request_, attributes);
+    if ( !action ) return false;
 
-    bool logged_in = user_.check();
-    if ( request_.matches("GET", "/pages/edit/") ) { // load page list editor
-        if ( logged_in && user_.can("pages.edit")) edit();
-        else throw HttpResponseException(Response::unauthorized);
-        return true;
-    }
-
-    if ( request_.matches("GET", "/pages/list/") ) { // fetch table data
-        if ( logged_in ) fetch();
-        else throw HttpResponseException(Response::unauthorized);
-        return true;
-    }
-
-    if ( request_.matches("GET|POST", "/pages/add/") ) {
-        if ( logged_in ) create();
-        else throw HttpResponseException(Response::unauthorized);
-        return true;
-    }
-    if ( request_.matches("GET|POST", "/pages/update/") ) {
-        if ( logged_in ) update();
-        else throw HttpResponseException(Response::unauthorized);
-        return true;
-    } else if ( request_.matches("GET", "/page/edit/{id}/", attributes) ) {
-        if ( logged_in ) edit(attributes.get("id"));
-        else throw HttpResponseException(Response::unauthorized);
-        return true;
-    } else if ( request_.matches("POST", "/page/publish/") ) {
-        if ( logged_in ) publish();
-        else throw HttpResponseException(Response::unauthorized);
-        return true;
-    } else if ( request_.matches("POST", "/pages/delete/") ) {
-        if ( logged_in ) remove();
-        else throw HttpResponseException(Response::unauthorized);
-        return true;
-    } else if ( request_.matches("GET", "/page/{id}/", attributes) ) {
-        show(attributes.get("id"));
-        return true;
-    } else
-        return false;
+    (*action)(*this, attributes);
+    return true;
 }
 
 void PageController::show(const std::string &page_id){
@@ -5,6 +5,8 @@
 
 #include <wspp/views/table.hpp>
 #include <wspp/server/exceptions.hpp>
+#include <wspp/server/router.hpp>
+#include <wspp/util/filesystem.hpp>
 
 #include "gpx_parser.hpp"
 
@@ -29,7 +31,10 @@ RouteCreateForm::RouteCreateForm(const Request &req, RouteModel &routes): reques
 
             const Request::UploadedFile &up = it->second;
 
-            GpxParser parser(up.data_, geom_);
+            // large uploads are saved in a temporary file
+            const string gpx = up.path_.empty() ? up.data_ : readFileToString(up.path_);
+
+            GpxParser parser(gpx, geom_);
             if ( !parser.parse() )
                 throw FormFieldValidationError("Not valid GPX file");
     });
@@ -144,11 +149,34 @@ void RouteController::update() {
     form.handle(request_, response_, engine_);
 }
 
+// the coordinates and names of the geometry, from which its GeoJSON is generated
+static string geometry_key(const RouteGeometry &geom) {
+    string key = geom.name_;
+    key += '\0';
+    for( const Track &track: geom.tracks_ ) {
+        key += track.name_; key += '\0';
+        for( const TrackSegment &seg: track.segments_ ) {
+            key += seg.name_; key += '\0';
+            key.append(reinterpret_cast<const char *>(seg.pts_.data()), seg.pts_.size() * sizeof(TrackPoint));
+        }
+    }
+    for( const Waypoint &wpt: geom.wpts_ ) {
+        key += wpt.name_; key += '\0';
+        key += wpt.desc_; key += '\0';
+        key.append(reinterpret_cast<const char *>(&wpt.lat_), 3 * sizeof(double));
+    }
+    return key;
+}
+
 void RouteController::track(const string &id) {
-    RouteGeometry geom;
-    routes_.fetchGeometry(id, geom);
-    Variant data = RouteModel::exportGeoJSON(geom);
-    response_.writeJSONVariant(data);
+    std::shared_ptr<RouteGeometry> geom = std::make_shared<RouteGeometry>();
+    routes_.fetchGeometry(id, *geom);
+
+    // the map fetches the track every time the route is viewed, skip generating it if the client has it
+    response_.headers_.replace("Cache-Control", "no-cache");
+    if ( response_.checkNotModified(request_, Response::entityTag(geometry_key(*geom), true)) ) return;
+
+    response_.stream(RouteModel::streamGeoJSON(geom), "application/json");
 }
 
 static string url_encode(const string &value) {
@@ -191,7 +219,7 @@ void RouteController::download(const string &format, const string &route_id) {
     string file_name = title + '.' + format;
 
     response_.headers_.replace("Cache-Control", "private");
-    if ( request_.SERVER_.get("HTTP_USER_AGENT").find("MSIE") != string::npos ) {
+    if ( request_.SERVER_.get("User-Agent").find("MSIE") != string::npos ) {
         response_.headers_.replace("Content-Disposition", "attachment; filename=" + url_encode ( file_name ));
     }  else {
         response_.headers_.replace("Content-Disposition", "attachment; filename*=UTF-8''" + url_encode ( file_name ));
@@ -215,71 +243,30 @@ void RouteController::remove(){
 }
 
 bool RouteController::dispatch(){
-    Dictionary attributes;
+    typedef void (*Action)(RouteController &c, const Dictionary &attributes);
+
+    static const Router<Action> routes {
+        { "GET", "/", [] (RouteController &c, const Dictionary &) { c.browse(std::string()); } },
+        { "GET", "/mountain/{mountain:[\\w]+}?", [] (RouteController &c, const Dictionary &a) { c.browse(a.get("mountain")); } },
+        { "GET", "/routes/edit/", [] (RouteController &c, const Dictionary &) { c.user_.require(); c.edit(); } },
+        { "GET", "/routes/list/", [] (RouteController &c, const Dictionary &) { c.user_.require(); c.list(); } },
+        { "GET|POST", "/routes/add/", [] (RouteController &c, const Dictionary &) { c.user_.require(); c.create(); } },
+        { "GET|POST", "/routes/update/", [] (RouteController &c, const Dictionary &) { c.user_.require(); c.update(); } },
+        { "GET", "/route/edit/{id}/", [] (RouteController &c, const Dictionary &a) { c.user_.require(); c.edit(a.get("id")); } },
+        { "POST", "/route/publish/", [] (RouteController &c, const Dictionary &) { c.user_.require(); c.publish(); } },
+        { "POST", "/routes/delete/", [] (RouteController &c, const Dictionary &) { c.user_.require(); c.remove(); } },
+        { "POST", "/query/route", [] (RouteController &c, const Dictionary &) { c.query(); } },
+        { "GET", "/download/track/{format:gpx|kml}/{id}", [] (RouteController &c, const Dictionary &a) { c.download(a.get("format"), a.get("id")); } },
+        { "GET", "/track/{id}/", [] (RouteController &c, const Dictionary &a) { c.track(a.get("id")); } },
+        { "GET", "/view/{id}/", [] (RouteController &c, const Dictionary &a) { c.view(a.get("id")); } }
+    };
 
-    bool logged_in = user_.check();
+    Dictionary attributes;
+    const Action *action = routes.match(request_, attributes);
+    if ( !action ) return false;
 
-    if ( request_.matches("GET", "/")  ) {
-        browse(std::string());
-        return true;
-    }
-    if ( request_.matches("GET", "/mountain/{mountain:[\\w]+}?", attributes)  ) {
-        browse(attributes.get("mountain"));
-        return true;
-    }
-    if ( request_.matches("GET", "/routes/edit/") ) {
-        if ( logged_in ) edit();
-        else throw HttpResponseException(Response::unauthorized);
-        return true;
-    }
-    if ( request_.matches("GET", "/routes/list/") ) {
-        if ( logged_in ) list();
-        else throw HttpResponseException(Response::unauthorized);
-        return true;
-    }
-    if ( request_.matches("GET|POST", "/routes/add/") ) {
-        if ( logged_in ) create();
-        else throw HttpResponseException(Response::unauthorized);
-        return true;
-    }
-    if ( request_.matches("GET|POST", "/routes/update/") ) {
-        if ( logged_in ) update();
-        else throw HttpResponseException(Response::unauthorized);
-        return true;
-    }
-    else if ( request_.matches("GET", "/route/edit/{id}/", attributes) ) {
-        if ( logged_in ) edit(attributes.get("id"));
-        else throw HttpResponseException(Response::unauthorized);
-        return true;
-    }
-    else if ( request_.matches("POST", "/route/publish/") ) {
-        if ( logged_in ) publish();
-        else throw HttpResponseException(Response::unauthorized);
-        return true;
-    }
-    else if ( request_.matches("POST", "/routes/delete/") ) {
-        if ( logged_in ) remove();
-        else throw HttpResponseException(Response::unauthorized);
-        return true;
-    }
-    else if ( request_.matches("POST", "/query/route") ) {
-        query();
-        return true;
-    }
-    else if ( request_.matches("GET", "/download/track/{format:gpx|kml}/{id}", attributes) ) {
-        download(attributes.get("format"), attributes.get("id"));
-        return true;
-    }
-    else if ( request_.matches("GET", "/track/{id}/", attributes) ) {
-        track(attributes.get("id"));
-        return true;
-    }
-    else if ( request_.matches("GET", "/view/{id}/", attributes) ) {
-        view(attributes.get("id"));
-        return true;
-    }
-    else
-        return false;
+    (*action)(*this, attributes);
+    return true;
 }
 
 void RouteController::view(const std::string &route_id) {
@@ -5,6 +5,7 @@
 #include <wspp/util/crypto.hpp>
 
 #include <boost/algorithm/string.hpp>
+#include <boost/filesystem.hpp>
 
 #include <spatialite.h>
 
@@ -163,14 +164,20 @@ bool RouteModel::importRoute(const string &title, const string &mountain_id, con
     trans.commit();
 }
 
-bool RouteModel::createAttachment(const string &route_id, const string &name, const string &type_id, const string &data, const string &upload_folder) {
+bool RouteModel::createAttachment(const string &route_id, const string &name, const string &type_id, const string &data, const string &data_path, const string &upload_folder) {
     string extension, target;
     size_t pos = name.rfind('.');
     if ( pos != string::npos ) extension = name.substr(pos);
     target = binToHex(randomBytes()) + extension;
 
-    ofstream ostrm(upload_folder + '/' + target);
-    ostrm.write(&data[0], data.size());
+    if ( !data_path.empty() ) {
+        boost::system::error_code ec;
+        boost::filesystem::copy_file(data_path, upload_folder + '/' + target, ec);
+        if ( ec ) return false;
+    } else {
+        ofstream ostrm(upload_folder + '/' + target);
+        ostrm.write(&data[0], data.size());
+    }
 
     Statement stmt(con_, "INSERT INTO attachments (route, 'type', name, url) VALUES (?, ?, ?, ?)", route_id, type_id, name, target);
     stmt.exec();
@@ -178,8 +185,27 @@ bool RouteModel::createAttachment(const string &route_id, const string &name, co
     return true;
 }
 
+static Variant geojson_box(const RouteGeometry &g) {
+    return Variant::Array{g.box_.min_lon_, g.box_.min_lat_, g.box_.max_lon_, g.box_.max_lat_};
+}
+
+static Variant geojson_waypoints(const RouteGeometry &g) {
+    Variant::Array wpt_features;
+    for( const Waypoint &wpt: g.wpts_ ) {
+        Variant::Array wpt_coords{ wpt.lon_, wpt.lat_ };
+        wpt_features.emplace_back(Variant::Object{{"type", "Feature"},
+                                                  {"name", wpt.name_ },
+                                                  {"desc", wpt.desc_ },
+                                                  {"geometry", Variant::Object{{"type", "Point"}, {"coordinates", wpt_coords}}}
+                                  });
+    }
+
+    return Variant::Object{{"type", "FeatureCollection"},
+                           {"features", wpt_features}};
+}
+
 Variant RouteModel::exportGeoJSON(const RouteGeometry &g) {
-    Variant::Array track_features, wpt_features;
+    Variant::Array track_features;
     for( const Track &tr: g.tracks_ ) {
         Variant::Array track_coords;
         for( const TrackSegment &seg: tr.segments_ ) {
@@ -196,24 +222,71 @@ Variant RouteModel::exportGeoJSON(const RouteGeometry &g) {
                                                     }});
     }
 
-    for( const Waypoint &wpt: g.wpts_ ) {
-        Variant::Array wpt_coords{ wpt.lon_, wpt.lat_ };
-        wpt_features.emplace_back(Variant::Object{{"type", "Feature"},
-                                                  {"name", wpt.name_ },
-                                                  {"desc", wpt.desc_ },
-                                                  {"geometry", Variant::Object{{"type", "Point"}, {"coordinates", wpt_coords}}}
-                                  });
-    }
-
     Variant::Object tracks{{"type", "FeatureCollection"},
                            {"features", track_features}};
 
-    Variant::Object wpts{{"type", "FeatureCollection"},
-                         {"features", wpt_features}};
+    return Variant::Object{{"box", geojson_box(g)}, {"tracks", tracks }, {"wpts", geojson_waypoints(g)} };
+}
+
+// Writes the JSON produced by exportGeoJSON without building it in memory. Track points are written directly
+// (formatted as Variant does) and each call stops after max_points so that large tracks are sent in pieces.
+class GeoJSONStream {
+public:
+    static const size_t max_points = 2048;
+
+    GeoJSONStream(const std::shared_ptr<RouteGeometry> &geom): geom_(geom) {}
+
+    bool operator () (ostream &strm) {
+        const RouteGeometry &g = *geom_;
+
+        if ( !started_ ) {
+            strm << "{\"box\": ";
+            geojson_box(g).toJSON(strm);
+            strm << ", \"tracks\": {\"features\": [";
+            started_ = true;
+        }
+
+        size_t written = 0;
+        for( ; track_ < g.tracks_.size() ; ++track_, segment_ = 0 ) {
+            const Track &tr = g.tracks_[track_];
+
+            if ( segment_ == 0 && point_ == 0 )
+                strm << ( track_ ? ", " : "" ) << "{\"geometry\": {\"coordinates\": [";
+
+            for( ; segment_ < tr.segments_.size() ; ++segment_, point_ = 0 ) {
+                const vector<TrackPoint> &pts = tr.segments_[segment_].pts_;
+
+                if ( point_ == 0 )
+                    strm << ( segment_ ? ", [" : "[" );
+
+                while ( point_ < pts.size() ) {
+                    const TrackPoint &pt = pts[point_];
+                    strm << ( point_ ? ", [" : "[" ) << pt.lon_ << ", " << pt.lat_ << "]";
+                    // only stop inside a segment, so that resuming never repeats an opening bracket
+                    if ( ++point_ < pts.size() && ++written >= max_points ) return true;
+                }
+
+                strm << "]";
+            }
+
+            strm << "], \"type\": \"MultiLineString\"}, \"type\": \"Feature\"}";
+        }
+
+        strm << "], \"type\": \"FeatureCollection\"}, \"wpts\": ";
+        geojson_waypoints(g).toJSON(strm);
+        strm << "}";
+
+        return false;
+    }
 
-    Variant::Array box{g.box_.min_lon_, g.box_.min_lat_, g.box_.max_lon_, g.box_.max_lat_};
+private:
+    std::shared_ptr<RouteGeometry> geom_;
+    bool started_ = false;
+    size_t track_ = 0, segment_ = 0, point_ = 0;
+};
 
-    return Variant::Object{{"box", box}, {"tracks", tracks }, {"wpts", wpts} };
+std::function<bool (ostream &)> RouteModel::streamGeoJSON(const std::shared_ptr<RouteGeometry> &geom) {
+    return GeoJSONStream(geom);
 }
 
 static GeomBox box_from_extent(const Blob &blob) {
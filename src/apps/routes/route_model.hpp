@@ -6,6 +6,9 @@
 
 #include "route_geometry.hpp"
 
+#include <functional>
+#include <memory>
+
 using wspp::db::Connection;
 using wspp::util::Variant;
 using wspp::util::Dictionary;
@@ -40,7 +43,8 @@ class RouteModel {
     bool getWaypoint(const std::string &id, std::string &name, std::string &desc);
 
     bool importRoute(const std::string &title, const std::string &role_id, const RouteGeometry &geom);
-    bool createAttachment(const std::string &route_id, const std::string &name, const std::string &type_id, const std::string &data, const std::string &upload_folder);
+    // the attachment is saved from data or, if data_path is not empty, copied from that file
+    bool createAttachment(const std::string &route_id, const std::string &name, const std::string &type_id, const std::string &data, const std::string &data_path, const std::string &upload_folder);
 
     void fetchGeometry(const std::string &route_id, RouteGeometry &geom);
 
@@ -49,6 +53,8 @@ class RouteModel {
     bool removeWaypoint(const std::string &id);
 
     static Variant exportGeoJSON(const RouteGeometry &geom);
+    // Same output as exportGeoJSON written a few track points per call, suitable for Response::stream
+    static std::function<bool (std::ostream &)> streamGeoJSON(const std::shared_ptr<RouteGeometry> &geom);
     static std::string exportGpx(const RouteGeometry &geom);
     static std::string exportKml(const RouteGeometry &geom);
 
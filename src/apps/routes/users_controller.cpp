@@ -6,6 +6,7 @@
 
 #include <wspp/views/table.hpp>
 #include <wspp/server/exceptions.hpp>
+#include <wspp/server/router.hpp>
 
 using namespace std;
 using namespace wspp::util;
@@ -159,38 +160,22 @@ void UsersController::remove(){
 }
 
 bool UsersController::dispatch(){
-    if ( !boost::starts_with(request_.path_, "/users") ) return false;
+    typedef void (*Action)(UsersController &c);
+
+    static const Router<Action> routes {
+        // load users list editor
+        { "GET", "/users/edit/", [] (UsersController &c) { c.user_.require("users.edit"); c.edit(); } },
+        // fetch table data
+        { "GET", "/users/list/", [] (UsersController &c) { c.user_.require("users.list"); c.fetch(); } },
+        { "GET|POST", "/users/add/", [] (UsersController &c) { c.user_.require("users.add"); c.create(); } },
+        { "GET|POST", "/users/update/", [] (UsersController &c) { c.user_.require("users.modify"); c.update(); } },
+        { "POST", "/users/delete/", [] (UsersController &c) { c.user_.require("users.delete"); c.remove(); } }
+    };
 
     Dictionary attributes;
+    const Action *action = routes.match(request_, attributes);
+    if ( !action ) return false;
 
-    bool logged_in = user_.check();
-    if ( request_.matches("GET", "/users/edit/") ) { // load users list editor
-        if ( logged_in && user_.can("users.edit")) edit();
-        else throw HttpResponseException(Response::unauthorized);
-        return true;
-    }
-
-    if ( request_.matches("GET", "/users/list/") ) { // fetch table data
-        if ( logged_in && user_.can("users.list")) fetch();
-        else throw HttpResponseException(Response::unauthorized);
-        return true;
-    }
-
-    if ( request_.matches("GET|POST", "/users/add/") ) {
-        if ( logged_in && user_.can("users.add")) create();
-        else throw HttpResponseException(Response::unauthorized);
-        return true;
-    }
-
-    if ( request_.matches("GET|POST", "/users/update/") ) {
-        if ( logged_in && user_.can("users.modify")) update();
-        else throw HttpResponseException(Response::unauthorized);
-        return true;
-    } else if ( request_.matches("POST", "/users/delete/") ) {
-        if ( logged_in && user_.can("users.delete") ) remove();
-        else throw HttpResponseException(Response::unauthorized);
-        return true;
-    } else {
-        return false;
-    }
+    (*action)(*this);
+    return true;
 }
\ No newline at end of file
@@ -5,6 +5,7 @@
 
 #include <wspp/views/table.hpp>
 #include <wspp/server/exceptions.hpp>
+#include <wspp/server/router.hpp>
 
 using namespace std;
 using namespace wspp::util;
@@ -77,27 +78,20 @@ void WaypointController::remove(const std::string &route_id){
 }
 
 bool WaypointController::dispatch(){
-    Dictionary attributes;
+    typedef void (*Action)(WaypointController &c, const Dictionary &attributes);
 
-    bool logged_in = user_.check();
+    static const Router<Action> routes {
+        { "GET", "/wpts/{id:\\d+}/list", [] (WaypointController &c, const Dictionary &a) { c.user_.require(); c.list(a.get("id")); } },
+        { "GET|POST", "/wpts/{id:\\d+}/update", [] (WaypointController &c, const Dictionary &a) { c.user_.require(); c.update(a.get("id")); } },
+        { "POST", "/wpts/{id:\\d+}/delete", [] (WaypointController &c, const Dictionary &a) { c.user_.require(); c.remove(a.get("id")); } }
+    };
 
-    if ( request_.matches("GET", "/wpts/{id:\\d+}/list", attributes) ) {
-        if ( logged_in ) list(attributes.get("id"));
-        else throw HttpResponseException(Response::unauthorized);
-        return true;
-    }
+    Dictionary attributes;
+    const Action *action = routes.match(request_, attributes);
+    if ( !action ) return false;
 
-    if ( request_.matches("GET|POST", "/wpts/{id:\\d+}/update", attributes) ) {
-        if ( logged_in ) update(attributes.get("id"));
-        else throw HttpResponseException(Response::unauthorized);
-        return true;
-    } else if ( request_.matches("POST", "/wpts/{id:\\d+}/delete", attributes) ) {
-        if ( logged_in ) remove(attributes.get("id"));
-        else throw HttpResponseException(Response::unauthorized);
-        return true;
-    } else {
-        return false;
-    }
+    (*action)(*this, attributes);
+    return true;
 }
 
 void WaypointController::list(const std::string &route_id){
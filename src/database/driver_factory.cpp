@@ -50,6 +50,8 @@ bool DriverFactory::parseParamString(const string &str, util::Dictionary &params
         if ( key.empty() ) return false;
         params.add(key, val);
     }
+
+    return true;
 }
 }
 }
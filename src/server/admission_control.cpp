@@ -0,0 +1,55 @@
+#include <wspp/server/detail/admission_control.hpp>
+
+namespace wspp {
+namespace server {
+namespace detail {
+
+AdmissionControl::AdmissionControl():
+    connections_(0), in_flight_(0), accepted_connections_(0), rejected_connections_(0), requests_(0),
+    rejected_requests_(0), dropped_requests_(0) {
+}
+
+bool AdmissionControl::acquireConnection(std::size_t max_connections) {
+    if ( ++connections_ > max_connections && max_connections ) {
+        --connections_;
+        ++rejected_connections_;
+        return false;
+    }
+
+    ++accepted_connections_;
+    return true;
+}
+
+void AdmissionControl::releaseConnection() {
+    --connections_;
+}
+
+bool AdmissionControl::acquireRequest(std::size_t max_in_flight) {
+    ++requests_;
+    if ( ++in_flight_ > max_in_flight && max_in_flight ) {
+        --in_flight_;
+        ++rejected_requests_;
+        return false;
+    }
+    return true;
+}
+
+void AdmissionControl::releaseRequest() {
+    --in_flight_;
+}
+
+ServerStats AdmissionControl::stats() const {
+    ServerStats s;
+    s.open_connections_ = connections_;
+    s.in_flight_requests_ = in_flight_;
+    s.accepted_connections_ = accepted_connections_;
+    s.rejected_connections_ = rejected_connections_;
+    s.requests_ = requests_;
+    s.rejected_requests_ = rejected_requests_;
+    s.dropped_requests_ = dropped_requests_;
+    return s;
+}
+
+} // namespace detail
+} // namespace server
+} // namespace wspp
@@ -0,0 +1,116 @@
+#include <wspp/server/detail/asset_cache.hpp>
+#include <wspp/server/response.hpp>
+#include <wspp/server/filters/compression_filter.hpp>
+#include <wspp/server/content_encoding.hpp>
+
+#include <sys/types.h>
+#include <sys/stat.h>
+
+using namespace std;
+
+namespace wspp {
+namespace server {
+namespace detail {
+
+AssetCache::AssetCache(std::size_t max_size, std::chrono::seconds ttl, std::size_t max_file_size):
+    max_file_size_(max_file_size), ttl_(ttl), entries_(max_size) {
+}
+
+std::size_t AssetCache::size() const {
+    return entries_.cost();
+}
+
+std::size_t AssetCache::cost(const Asset &asset) {
+    std::size_t total = asset.body_->size();
+    for( const auto &e: asset.encoded_ )
+        total += e.second->size();
+    return total;
+}
+
+std::shared_ptr<FileBody> AssetCache::Asset::select(const string &accept_encoding, string &encoding) const {
+    if ( encoded_.empty() ) return nullptr;
+
+    const ContentEncoding *e = ContentEncodings::instance().negotiate(accept_encoding,
+                        [this] (const ContentEncoding &c) { return encoded_.count(c.name()) != 0; });
+    if ( !e ) return nullptr;
+
+    encoding = e->name();
+    return encoded_.find(encoding)->second;
+}
+
+std::shared_ptr<const AssetCache::Asset> AssetCache::get(const string &path) {
+    auto now = std::chrono::steady_clock::now();
+
+    Entry entry;
+    if ( entries_.get(path, entry) ) {
+        if ( now - entry.checked_ < ttl_ ) return entry.asset_;
+
+        // other threads use the cached copy while the file is checked
+        entry.checked_ = now;
+        entries_.put(path, entry, cost(*entry.asset_));
+
+        struct stat st;
+        const FileBody &body = *entry.asset_->body_;
+        if ( ::stat(path.c_str(), &st) == 0 && S_ISREG(st.st_mode) && (uint64_t)st.st_ino == body.inode() &&
+             st.st_mtime == body.mtime() && (uint64_t)st.st_size == body.size() )
+            return entry.asset_;
+    }
+
+    // not cached or modified since
+    std::shared_ptr<const Asset> asset = load(path);
+    if ( asset ) entries_.put(path, Entry{asset, now}, cost(*asset));
+    else entries_.erase(path);
+
+    return asset;
+}
+
+static bool is_gzip_data(const string &bytes) {
+    return bytes.size() > 2 && bytes[0] == 0x1f && (unsigned char)bytes[1] == 0x8b;
+}
+
+// the slowest settings are used for small files only so that loading a large file does not stall the request
+static const size_t max_best_compressed_file = 256 * 1024;
+
+// the precompressed copy of a file with the given extension if it exists and is up to date
+static std::shared_ptr<FileBody> load_precompressed(const string &path, const string &extension, const FileBody &file) {
+    std::shared_ptr<FileBody> encoded = FileBody::open(path + extension);
+    if ( !encoded || encoded->mtime() < file.mtime() ) return nullptr;
+
+    return FileBody::fromMemory(encoded->read(0, encoded->size()), file.mtime(), file.inode());
+}
+std::shared_ptr<const AssetCache::Asset> AssetCache::load(const string &path) {
+    std::shared_ptr<FileBody> file = FileBody::open(path);
+    if ( !file || file->size() > max_file_size_ ) return nullptr;
+
+    std::shared_ptr<Asset> asset = std::make_shared<Asset>();
+    string contents = file->read(0, file->size());
+
+    asset->mime_ = Response::fileMimeType(path);
+    if ( is_gzip_data(contents) ) asset->encoding_ = "gzip";
+
+    // compress once what the compression filter would compress for every response
+    if ( asset->encoding_.empty() && content_benefits_from_compression(asset->mime_) ) {
+        ContentEncoding::Quality quality = contents.size() <= max_best_compressed_file ?
+                    ContentEncoding::best : ContentEncoding::balanced;
+
+        for( const auto &encoding: ContentEncodings::instance().all() ) {
+            std::shared_ptr<FileBody> encoded = load_precompressed(path, encoding->extension(), *file);
+
+            if ( !encoded ) {
+                string data;
+                encoding->compress(contents.data(), contents.size(), data, quality);
+                if ( data.size() < contents.size() )
+                    encoded = FileBody::fromMemory(std::move(data), file->mtime(), file->inode());
+            }
+
+            if ( encoded ) asset->encoded_.emplace(encoding->name(), encoded);
+        }
+    }
+
+    asset->body_ = FileBody::fromMemory(std::move(contents), file->mtime(), file->inode());
+    return asset;
+}
+
+} // namespace detail
+} // namespace server
+} // namespace wspp
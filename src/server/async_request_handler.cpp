@@ -0,0 +1,13 @@
+#include <wspp/server/async_request_handler.hpp>
+
+namespace wspp {
+namespace server {
+void AsyncRequestHandler::handle(const Request &req, Response &resp) {
+    boost::asio::io_service io;
+    boost::asio::spawn(io, [&](boost::asio::yield_context yield) {
+        handle(req, resp, io, yield);
+    });
+    io.run();
+}
+} // namespace server
+} // namespace wspp
@@ -11,29 +11,87 @@
 #include <wspp/server/detail/connection_manager.hpp>
 #include <wspp/server/detail/connection.hpp>
 
+#include <boost/intrusive/list.hpp>
+#include <boost/thread.hpp>
+
 namespace wspp {
 namespace server {
-ConnectionManager::ConnectionManager(){
+struct ConnectionManager::Shard {
+    boost::intrusive::list<HttpConnection> connections_;
+    boost::mutex mutex_;
+};
+
+ConnectionManager::ConnectionManager(std::size_t num_shards){
+    for( std::size_t i=0 ; i<std::max<std::size_t>(num_shards, 1) ; i++ )
+        shards_.emplace_back(new Shard());
 }
 
-void ConnectionManager::start(ConnectionPtr c){
-    boost::unique_lock<boost::mutex> lock(mutex_);
-    connections_.insert(c);
+ConnectionManager::~ConnectionManager(){
+    // connections still registered are owned by the manager; unlink them before the lists go away
+    stop_all();
+}
+
+void ConnectionManager::start(ConnectionPtr c, std::size_t shard){
+    c->shard_ = shard % shards_.size();
+
+    Shard &s = *shards_[c->shard_];
+    {
+        boost::unique_lock<boost::mutex> lock(s.mutex_);
+        s.connections_.push_back(*c);
+        // the manager owns the connection while it is in the list
+        c->registered_ = c;
+    }
+
     c->start();
 }
 
 void ConnectionManager::stop(ConnectionPtr c){
-    boost::unique_lock<boost::mutex> lock(mutex_);
-    if ( connections_.count(c) )
-          connections_.erase(c);
+    Shard &s = *shards_[c->shard_];
+    {
+        boost::unique_lock<boost::mutex> lock(s.mutex_);
+        if ( c->is_linked() ) {
+            s.connections_.erase(s.connections_.iterator_to(*c));
+            c->registered_.reset();
+        }
+    }
     c->stop();
 }
 
 void ConnectionManager::stop_all(){
-    boost::unique_lock<boost::mutex> lock(mutex_);
-    for (auto c: connections_)
+    for( std::size_t i=0 ; i<shards_.size() ; i++ )
+        stop_all(i);
+}
+
+void ConnectionManager::stop_all(std::size_t shard){
+    Shard &s = *shards_[shard % shards_.size()];
+
+    std::vector<ConnectionPtr> connections;
+    {
+        boost::unique_lock<boost::mutex> lock(s.mutex_);
+        while ( !s.connections_.empty() ) {
+            HttpConnection &c = s.connections_.front();
+            s.connections_.pop_front();
+            connections.emplace_back(std::move(c.registered_));
+        }
+    }
+
+    for (auto c: connections)
         c->stop();
-    connections_.clear();
+}
+
+bool ConnectionsPerAddress::acquire(const boost::asio::ip::address &address, std::size_t max_connections){
+    boost::unique_lock<boost::mutex> lock(mutex_);
+    std::size_t &count = counts_[address];
+    if ( max_connections && count >= max_connections ) return false;
+    ++count;
+    return true;
+}
+
+void ConnectionsPerAddress::release(const boost::asio::ip::address &address){
+    boost::unique_lock<boost::mutex> lock(mutex_);
+    auto it = counts_.find(address);
+    if ( it != counts_.end() && --it->second == 0 )
+        counts_.erase(it);
 }
 } // namespace server
-} // namespace wspp
\ No newline at end of file
+} // namespace wspp
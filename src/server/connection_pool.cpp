@@ -0,0 +1,79 @@
+#include <wspp/server/detail/connection_pool.hpp>
+#include <wspp/server/detail/connection.hpp>
+
+#include <boost/thread.hpp>
+
+namespace wspp {
+namespace server {
+namespace detail {
+
+struct ConnectionPool::Shard {
+    std::vector<HttpConnection *> free_;
+    boost::mutex mutex_;
+};
+
+// deleter of pooled connections, returns them to the pool if it still exists
+struct ConnectionPool::Recycler {
+    Recycler(const std::shared_ptr<ConnectionPool> &pool, std::size_t shard): pool_(pool), shard_(shard) {}
+
+    void operator()(HttpConnection *c) const {
+        if ( std::shared_ptr<ConnectionPool> pool = pool_.lock() )
+            pool->recycle(shard_, c);
+        else
+            delete c;
+    }
+
+    std::weak_ptr<ConnectionPool> pool_;
+    std::size_t shard_;
+};
+
+ConnectionPool::ConnectionPool(std::size_t num_shards, std::size_t max_free): max_free_(max_free) {
+    for( std::size_t i=0 ; i<std::max<std::size_t>(num_shards, 1) ; i++ )
+        shards_.emplace_back(new Shard());
+}
+
+ConnectionPool::~ConnectionPool() {
+    for( auto &s: shards_ ) {
+        for( HttpConnection *c: s->free_ )
+            delete c;
+    }
+}
+
+ConnectionPtr ConnectionPool::create(std::size_t shard, boost::asio::io_service &io, ConnectionManager &manager,
+                                     const FilterChain &handler, const ConnectionOptions &options) {
+    shard %= shards_.size();
+    Shard &s = *shards_[shard];
+
+    HttpConnection *c = nullptr;
+    {
+        boost::unique_lock<boost::mutex> lock(s.mutex_);
+        if ( !s.free_.empty() ) {
+            c = s.free_.back();
+            s.free_.pop_back();
+        }
+    }
+
+    if ( !c ) c = new HttpConnection(io, manager, handler, options);
+
+    return ConnectionPtr(c, Recycler(shared_from_this(), shard));
+}
+
+void ConnectionPool::recycle(std::size_t shard, HttpConnection *c) {
+    // no handler refers to the connection any more so it can be reset from any thread
+    c->recycle();
+
+    Shard &s = *shards_[shard];
+    {
+        boost::unique_lock<boost::mutex> lock(s.mutex_);
+        if ( s.free_.size() < max_free_ ) {
+            s.free_.push_back(c);
+            return;
+        }
+    }
+
+    delete c;
+}
+
+} // namespace detail
+} // namespace server
+} // namespace wspp
@@ -0,0 +1,266 @@
+#include <wspp/server/content_encoding.hpp>
+#include <wspp/server/detail/gzip_encoder.hpp>
+
+#include <boost/algorithm/string.hpp>
+
+#ifdef HAS_BROTLI_ENCODING
+#include <brotli/encode.h>
+#endif
+
+#ifdef HAS_ZSTD_ENCODING
+#include <zstd.h>
+#endif
+
+#include <stdexcept>
+
+using namespace std;
+
+namespace wspp {
+namespace server {
+
+void ContentEncoding::compress(const char *data, size_t size, string &out, Quality quality) const {
+    out.clear();
+    encoder(quality)->compress(data, size, out, true);
+}
+
+namespace {
+
+class GzipEncoding: public ContentEncoding {
+public:
+    GzipEncoding(): ContentEncoding("gzip", ".gz") {}
+
+    class Encoder: public ContentEncoding::Encoder {
+    public:
+        Encoder(int level): encoder_(level) {}
+
+        void compress(const char *data, size_t size, string &out, bool finish) override {
+            encoder_.compress(data, size, out, finish);
+        }
+
+    private:
+        detail::GzipEncoder encoder_;
+    };
+
+    std::unique_ptr<ContentEncoding::Encoder> encoder(Quality quality) const override {
+        return std::unique_ptr<ContentEncoding::Encoder>(new Encoder(level(quality)));
+    }
+
+    void compress(const char *data, size_t size, string &out, Quality quality) const override {
+        detail::GzipEncoder::compress(data, size, out, level(quality));
+    }
+
+private:
+    static int level(Quality quality) {
+        return quality == fastest ? Z_BEST_SPEED : quality == best ? Z_BEST_COMPRESSION : 6;
+    }
+};
+
+#ifdef HAS_BROTLI_ENCODING
+class BrotliEncoding: public ContentEncoding {
+public:
+    BrotliEncoding(): ContentEncoding("br", ".br") {}
+
+    class Encoder: public ContentEncoding::Encoder {
+    public:
+        Encoder(int quality): state_(BrotliEncoderCreateInstance(nullptr, nullptr, nullptr)) {
+            if ( !state_ ) throw std::bad_alloc();
+            BrotliEncoderSetParameter(state_, BROTLI_PARAM_QUALITY, quality);
+        }
+
+        ~Encoder() {
+            BrotliEncoderDestroyInstance(state_);
+        }
+
+        void compress(const char *data, size_t size, string &out, bool finish) override {
+            const uint8_t *next_in = reinterpret_cast<const uint8_t *>(data);
+            size_t avail_in = size;
+            BrotliEncoderOperation op = finish ? BROTLI_OPERATION_FINISH : BROTLI_OPERATION_PROCESS;
+
+            while ( true ) {
+                size_t avail_out = 0;
+                if ( !BrotliEncoderCompressStream(state_, op, &avail_in, &next_in, &avail_out, nullptr, nullptr) )
+                    throw std::runtime_error("brotli: compression failed");
+
+                // take the output from the encoder without copying it to an intermediate buffer
+                size_t n = 0;
+                const uint8_t *output = BrotliEncoderTakeOutput(state_, &n);
+                out.append(reinterpret_cast<const char *>(output), n);
+
+                if ( avail_in == 0 && !BrotliEncoderHasMoreOutput(state_) &&
+                     ( !finish || BrotliEncoderIsFinished(state_) ) ) break;
+            }
+        }
+
+    private:
+        BrotliEncoderState *state_;
+    };
+
+    std::unique_ptr<ContentEncoding::Encoder> encoder(Quality q) const override {
+        return std::unique_ptr<ContentEncoding::Encoder>(new Encoder(quality(q)));
+    }
+
+    void compress(const char *data, size_t size, string &out, Quality q) const override {
+        size_t n = BrotliEncoderMaxCompressedSize(size);
+        if ( n == 0 ) {
+            ContentEncoding::compress(data, size, out, q);
+            return;
+        }
+
+        out.resize(n);
+        if ( !BrotliEncoderCompress(quality(q), BROTLI_DEFAULT_WINDOW, BROTLI_MODE_GENERIC, size,
+                                    reinterpret_cast<const uint8_t *>(data), &n, reinterpret_cast<uint8_t *>(&out[0])) )
+            throw std::runtime_error("brotli: compression failed");
+        out.resize(n);
+    }
+
+private:
+    // the highest qualities are much slower and only pay off for content compressed once, while qualities 0 and 1
+    // emit a block for every piece of a streamed body
+    static int quality(Quality q) {
+        return q == fastest ? 2 : q == best ? BROTLI_MAX_QUALITY : 5;
+    }
+};
+#endif
+
+#ifdef HAS_ZSTD_ENCODING
+class ZstdEncoding: public ContentEncoding {
+public:
+    ZstdEncoding(): ContentEncoding("zstd", ".zst") {}
+
+    class Encoder: public ContentEncoding::Encoder {
+    public:
+        Encoder(int level): ctx_(ZSTD_createCCtx()) {
+            if ( !ctx_ ) throw std::bad_alloc();
+            ZSTD_CCtx_setParameter(ctx_, ZSTD_c_compressionLevel, level);
+        }
+
+        ~Encoder() {
+            ZSTD_freeCCtx(ctx_);
+        }
+
+        void compress(const char *data, size_t size, string &out, bool finish) override {
+            ZSTD_inBuffer input = { data, size, 0 };
+            ZSTD_EndDirective mode = finish ? ZSTD_e_end : ZSTD_e_continue;
+            size_t step = ZSTD_CStreamOutSize();
+
+            while ( true ) {
+                size_t used = out.size();
+                out.resize(used + step);
+                ZSTD_outBuffer output = { &out[used], step, 0 };
+
+                size_t remaining = ZSTD_compressStream2(ctx_, &output, &input, mode);
+                if ( ZSTD_isError(remaining) )
+                    throw std::runtime_error(string("zstd: ") + ZSTD_getErrorName(remaining));
+
+                out.resize(used + output.pos);
+
+                if ( finish ? remaining == 0 : input.pos == input.size ) break;
+            }
+        }
+
+    private:
+        ZSTD_CCtx *ctx_;
+    };
+
+    std::unique_ptr<ContentEncoding::Encoder> encoder(Quality quality) const override {
+        return std::unique_ptr<ContentEncoding::Encoder>(new Encoder(level(quality)));
+    }
+
+    void compress(const char *data, size_t size, string &out, Quality quality) const override {
+        out.resize(ZSTD_compressBound(size));
+        size_t n = ZSTD_compress(&out[0], out.size(), data, size, level(quality));
+        if ( ZSTD_isError(n) )
+            throw std::runtime_error(string("zstd: ") + ZSTD_getErrorName(n));
+        out.resize(n);
+    }
+
+private:
+    static int level(Quality quality) {
+        return quality == fastest ? 1 : quality == best ? 19 : 3;
+    }
+};
+#endif
+
+} // namespace
+
+ContentEncodings::ContentEncodings() {
+    add(std::make_shared<GzipEncoding>());
+#ifdef HAS_ZSTD_ENCODING
+    add(std::make_shared<ZstdEncoding>());
+#endif
+#ifdef HAS_BROTLI_ENCODING
+    add(std::make_shared<BrotliEncoding>());
+#endif
+}
+
+ContentEncodings &ContentEncodings::instance() {
+    static ContentEncodings encodings;
+    return encodings;
+}
+
+void ContentEncodings::add(const std::shared_ptr<ContentEncoding> &encoding) {
+    encodings_.insert(encodings_.begin(), encoding);
+}
+
+const ContentEncoding *ContentEncodings::find(const string &name) const {
+    for( const auto &e: encodings_ )
+        if ( boost::algorithm::iequals(e->name(), name) ) return e.get();
+    return nullptr;
+}
+
+// quality value of a q=... parameter, 1 if missing or invalid
+static double parse_qvalue(const string &params) {
+    size_t pos = params.find("q=");
+    if ( pos == string::npos ) return 1.0;
+    try {
+        return std::stod(params.substr(pos + 2));
+    } catch ( ... ) {
+        return 1.0;
+    }
+}
+
+const ContentEncoding *ContentEncodings::negotiate(const string &accept_encoding,
+                                                   const std::function<bool (const ContentEncoding &)> &available) const {
+    if ( accept_encoding.empty() ) return nullptr;
+
+    // quality of each coding and of the codings not listed (given by *)
+    vector<double> qualities(encodings_.size(), -1.0);
+    double others = 0.0;
+
+    size_t pos = 0;
+    while ( pos < accept_encoding.size() ) {
+        size_t end = accept_encoding.find(',', pos);
+        if ( end == string::npos ) end = accept_encoding.size();
+
+        string item = boost::algorithm::trim_copy(accept_encoding.substr(pos, end - pos));
+        pos = end + 1;
+
+        size_t semi = item.find(';');
+        string name = boost::algorithm::trim_copy(item.substr(0, semi));
+        double q = semi == string::npos ? 1.0 : parse_qvalue(item.substr(semi + 1));
+
+        if ( name == "*" ) {
+            others = q;
+            continue;
+        }
+
+        for( size_t i = 0 ; i < encodings_.size() ; i++ )
+            if ( boost::algorithm::iequals(encodings_[i]->name(), name) ) qualities[i] = q;
+    }
+
+    const ContentEncoding *best = nullptr;
+    double best_q = 0.0;
+    for( size_t i = 0 ; i < encodings_.size() ; i++ ) {
+        double q = qualities[i] < 0 ? others : qualities[i];
+        // ties go to the preferred coding, which comes first
+        if ( q > best_q && ( !available || available(*encodings_[i]) ) ) {
+            best = encodings_[i].get();
+            best_q = q;
+        }
+    }
+
+    return best;
+}
+
+} // namespace server
+} // namespace wspp
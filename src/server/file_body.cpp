@@ -0,0 +1,73 @@
+#include <wspp/server/detail/file_body.hpp>
+
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+using namespace std;
+
+namespace wspp {
+namespace server {
+namespace detail {
+FileBody::~FileBody() {
+    if ( fd_ != -1 ) ::close(fd_);
+}
+
+std::shared_ptr<FileBody> FileBody::open(const string &path) {
+    int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if ( fd == -1 ) return nullptr;
+
+    std::shared_ptr<FileBody> file(new FileBody());
+    file->fd_ = fd;
+
+    struct stat st;
+    if ( fstat(fd, &st) != 0 || !S_ISREG(st.st_mode) ) return nullptr;
+
+    file->size_ = st.st_size;
+    file->mtime_ = st.st_mtime;
+    file->inode_ = st.st_ino;
+
+    // a file truncated meanwhile is served as read
+    if ( file->size_ > 0 && file->size_ <= max_loaded_size ) {
+        file->contents_ = file->read(0, file->size_);
+        file->data_ = file->contents_.data();
+        file->size_ = file->contents_.size();
+    }
+
+    return file;
+}
+
+std::shared_ptr<FileBody> FileBody::fromMemory(string contents, time_t mtime, uint64_t inode) {
+    std::shared_ptr<FileBody> file(new FileBody());
+    file->contents_ = std::move(contents);
+    file->data_ = file->contents_.data();
+    file->size_ = file->contents_.size();
+    file->mtime_ = mtime;
+    file->inode_ = inode;
+    return file;
+}
+
+string FileBody::read(uint64_t offset, uint64_t count) const {
+    if ( offset >= size_ ) return string();
+    if ( count > size_ - offset ) count = size_ - offset;
+
+    if ( data_ ) return string(data_ + offset, count);
+
+    string res;
+    res.resize(count);
+
+    size_t total = 0;
+    while ( total < count ) {
+        ssize_t n = pread(fd_, &res[total], count - total, offset + total);
+        if ( n <= 0 ) break;
+        total += n;
+    }
+
+    res.resize(total);
+    return res;
+}
+
+} // namespace detail
+} // namespace server
+} // namespace wspp
@@ -1,10 +1,12 @@
 #include <wspp/server/filter_chain.hpp>
 #include <wspp/server/request_handler.hpp>
+#include <wspp/server/async_request_handler.hpp>
 
 namespace wspp {
 namespace server {
 void FilterChain::setEndPoint(RequestHandler *end_point) {
     end_point_ = end_point;
+    async_end_point_ = dynamic_cast<AsyncRequestHandler *>(end_point);
 }
 
 void FilterChain::next(Request &req, Response &resp) {
@@ -16,16 +18,27 @@ void FilterChain::add(Filter *f) {
     filters_.emplace_back(f);
 }
 
-void FilterChain::handle(Request &req, Response &resp) {
-    current_ = filters_.begin();
-    doHandle(req, resp);
+void FilterChain::handle(Request &req, Response &resp) const {
+    FilterChain cursor(this);
+    cursor.doHandle(req, resp);
+}
+
+void FilterChain::handle(Request &req, Response &resp, boost::asio::io_service &io, boost::asio::yield_context yield) const {
+    FilterChain cursor(this);
+    cursor.io_ = &io;
+    cursor.yield_ = &yield;
+    cursor.doHandle(req, resp);
 }
 
 void FilterChain::doHandle(Request &req, Response &resp) {
-    if ( current_ != filters_.end() )
-        (*current_)->handle(req, resp, *this);
-    else if ( end_point_ )
-        end_point_->handle(req, resp);
+    const FilterList &filters = root_->filters_;
+
+    if ( current_ < filters.size() )
+        filters[current_]->handle(req, resp, *this);
+    else if ( root_->async_end_point_ && yield_ )
+        root_->async_end_point_->handle(req, resp, *io_, *yield_);
+    else if ( root_->end_point_ )
+        root_->end_point_->handle(req, resp);
 }
 }
 }
@@ -0,0 +1,151 @@
+#include <wspp/server/filters/compression_filter.hpp>
+#include <wspp/server/filter_chain.hpp>
+#include <wspp/server/detail/file_body.hpp>
+#include <wspp/server/detail/lru_cache.hpp>
+
+#include <boost/algorithm/string.hpp>
+
+#include <unordered_set>
+
+using namespace std;
+using namespace wspp::util;
+namespace wspp {
+namespace server {
+static const size_t min_compressed_length = 200;
+// file bodies (see Response::encodeFile) up to this size are loaded and compressed, larger ones are sent as they are
+static const size_t max_compressed_file_length = 1024 * 1024;
+// compressed bodies are kept for reuse by the thread when they are no larger than this
+static const size_t max_pooled_buffer = 256 * 1024;
+
+// compressible types besides text/*
+static const unordered_set<string> compressible_mime_types {
+    "application/javascript", "application/x-javascript", "application/json", "application/geo+json",
+    "application/xml", "application/xhtml+xml", "application/rss+xml", "application/atom+xml",
+    "application/gpx+xml", "application/vnd.google-earth.kml+xml", "image/svg+xml"
+};
+
+bool content_benefits_from_compression(const string &mime) {
+    // ignore parameters such as the charset
+    size_t end = mime.find(';');
+    if ( end == string::npos ) end = mime.size();
+    while ( end > 0 && mime[end-1] == ' ' ) end--;
+
+    string type = boost::algorithm::to_lower_copy(mime.substr(0, end));
+    return type.compare(0, 5, "text/") == 0 || compressible_mime_types.count(type);
+}
+
+CompressionFilter::CompressionFilter(ContentEncoding::Quality quality, size_t fast_size, size_t cache_size):
+    quality_(quality), fast_size_(fast_size) {
+    if ( cache_size )
+        cache_.reset(new detail::LruCache<string, std::shared_ptr<detail::FileBody>>(cache_size));
+}
+
+CompressionFilter::~CompressionFilter() {}
+
+// compress each piece produced by the generator of a streamed reply
+void CompressionFilter::compressStream(Response &resp, const ContentEncoding &encoding) {
+    struct State {
+        State(std::unique_ptr<ContentEncoding::Encoder> encoder): encoder_(std::move(encoder)) {}
+
+        std::unique_ptr<ContentEncoding::Encoder> encoder_;
+        ostringstream piece_;
+        string out_;
+    };
+
+    auto state = std::make_shared<State>(encoding.encoder(ContentEncoding::fastest));
+    Response::ContentGenerator generator = resp.generator_;
+
+    resp.generator_ = [state, generator] (ostream &strm) {
+        state->piece_.str(string());
+        bool more = generator(state->piece_);
+
+        const string &piece = state->piece_.str();
+        state->out_.clear();
+        state->encoder_->compress(piece.data(), piece.size(), state->out_, !more);
+        strm.write(state->out_.data(), state->out_.size());
+        return more;
+    };
+
+    // the length of the compressed body is not known
+    resp.headers_.remove("Content-Length");
+}
+
+void CompressionFilter::handle(Request &req, Response &resp, FilterChain &chain){
+    chain.next(req, resp);
+
+    if ( resp.status_ != Response::ok || resp.headers_.contains("Content-Encoding") ||
+         !content_benefits_from_compression(resp.headers_.get("Content-Type")) )
+        return;
+
+    if ( !resp.generator_ ) {
+        uint64_t length = resp.contentLength();
+        if ( length <= min_compressed_length || ( resp.file_ && length > max_compressed_file_length ) ) return;
+    }
+
+    // the reply depends on the accepted encodings even if this client gets it uncompressed
+    resp.headers_.replace("Vary", "Accept-Encoding");
+
+    const ContentEncoding *encoding = ContentEncodings::instance().negotiate(req.SERVER_.get("Accept-Encoding"));
+    if ( !encoding ) return;
+
+    resp.headers_.replace("Content-Encoding", encoding->name());
+
+    // the compressed body is not byte for byte the one the entity tag was computed from, it is still a key of the
+    // cache since it identifies the content
+    string etag;
+    auto it = resp.headers_.find("ETag");
+    if ( it != resp.headers_.end() ) {
+        etag = it->second;
+        if ( etag.compare(0, 2, "W/") != 0 ) it->second.insert(0, "W/");
+    }
+
+    if ( resp.generator_ ) {
+        compressStream(resp, *encoding);
+        return;
+    }
+
+    // cacheable replies have a strong entity tag and may be stored
+    bool cacheable = cache_ && !etag.empty() && etag[0] == '"' &&
+            resp.headers_.get("Cache-Control").find("no-store") == string::npos;
+
+    string key;
+    if ( cacheable ) key = etag + ':' + encoding->name();
+
+    std::shared_ptr<detail::FileBody> cached;
+    if ( cacheable && cache_->get(key, cached) ) {
+        resp.content_.clear();
+        resp.file_ = cached;
+        resp.ranges_.clear();
+        resp.setContentLength();
+        return;
+    }
+
+    const char *data = resp.file_ ? resp.file_->data() : resp.content_.data();
+    string file_data;
+    if ( resp.file_ && !data ) {
+        file_data = resp.file_->read(0, resp.file_->size());
+        data = file_data.data();
+    }
+
+    // compress into a buffer of the thread and hand the memory of the uncompressed body to the thread in exchange
+    static thread_local string buffer;
+    uint64_t length = resp.contentLength();
+    encoding->compress(data, length, buffer, length > fast_size_ ? ContentEncoding::fastest : quality_);
+
+    if ( cacheable ) {
+        resp.file_ = detail::FileBody::fromMemory(buffer, 0, 0);
+        resp.content_.clear();
+        resp.ranges_.clear();
+        cache_->put(key, resp.file_, buffer.size());
+    }
+    else {
+        resp.file_.reset();
+        resp.content_.swap(buffer);
+    }
+
+    if ( buffer.capacity() > max_pooled_buffer ) string().swap(buffer);
+
+    resp.setContentLength();
+}
+} // namespace server
+} // namespace wspp
@@ -0,0 +1,43 @@
+#include <wspp/server/filters/metrics_filter.hpp>
+
+#include <wspp/server/request.hpp>
+#include <wspp/server/response.hpp>
+#include <wspp/server/filter_chain.hpp>
+#include <wspp/server/exceptions.hpp>
+
+#include <chrono>
+
+namespace wspp {
+namespace server {
+MetricsFilter::MetricsFilter(MetricsRegistry &registry, const std::string &path):
+    registry_(registry), path_(path),
+    requests_(registry.counter("http_requests_total", "Requests handled by route and status.", {"route", "status"})),
+    duration_(registry.histogram("http_request_duration_seconds", "Time spent handling requests by route.", {"route"})) {
+}
+
+void MetricsFilter::handle(Request &req, Response &resp, FilterChain &chain) {
+    if ( req.path_ == path_ && req.method_ == "GET" ) {
+        resp.write(registry_.scrape(), "text/plain; version=0.0.4");
+        return;
+    }
+
+    auto start = std::chrono::steady_clock::now();
+    try {
+        chain.next(req, resp);
+    } catch ( HttpResponseException &e ) {
+        record(req, e.code_, std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count());
+        throw;
+    } catch ( ... ) {
+        record(req, Response::internal_server_error, std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count());
+        throw;
+    }
+
+    record(req, resp.status_, std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count());
+}
+
+void MetricsFilter::record(const Request &req, int status, double seconds) {
+    requests_.inc({req.route_, std::to_string(status)});
+    duration_.observe({req.route_}, seconds);
+}
+} // namespace server
+} // namespace wspp
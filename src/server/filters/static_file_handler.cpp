@@ -3,19 +3,81 @@
 #include <wspp/server/request.hpp>
 #include <wspp/server/response.hpp>
 #include <wspp/server/filter_chain.hpp>
+#include <wspp/server/detail/asset_cache.hpp>
+#include <wspp/server/content_encoding.hpp>
 
 #include <boost/filesystem.hpp>
+#include <boost/algorithm/string.hpp>
+
+#include <set>
 
 namespace fs = boost::filesystem;
 
 using namespace wspp::util;
 namespace wspp {
 namespace server {
+StaticFileHandler::StaticFileHandler(const std::string &route_dir, std::size_t cache_size, std::size_t ttl,
+                                     std::size_t max_cached_file): root_(route_dir) {
+    if ( cache_size )
+        cache_.reset(new detail::AssetCache(cache_size, std::chrono::seconds(ttl), max_cached_file));
+}
+
+StaticFileHandler::~StaticFileHandler() {}
+
+// serve a file that is not cached, or its precompressed copy for the encoding the client prefers
+void StaticFileHandler::encodeLargeFile(const std::string &path, const std::string &accept_encoding, Response &resp) {
+    time_t mtime = fs::last_write_time(path);
+
+    // the copies that are not older than the file
+    std::set<std::string> siblings;
+    for( const auto &e: ContentEncodings::instance().all() ) {
+        boost::system::error_code ec;
+        std::string sibling = path + e->extension();
+        if ( fs::is_regular_file(sibling, ec) && fs::last_write_time(sibling, ec) >= mtime ) siblings.insert(e->name());
+    }
+
+    if ( siblings.empty() ) {
+        resp.encodeFile(path);
+        return;
+    }
+
+    resp.headers_.replace("Vary", "Accept-Encoding");
+
+    const ContentEncoding *encoding = ContentEncodings::instance().negotiate(accept_encoding,
+                        [&siblings] (const ContentEncoding &e) { return siblings.count(e.name()) != 0; });
+    if ( encoding )
+        resp.encodeFile(path + encoding->extension(), encoding->name(), Response::fileMimeType(path));
+    else
+        resp.encodeFile(path);
+}
+
 void StaticFileHandler::handle(Request &req, Response &resp, FilterChain &chain) {
     if ( resp.status_ != Response::ok && req.method_ == "GET" ) {
-        fs::path p(root_ + req.path_) ;
-        if ( fs::exists(p) )
-            resp.encodeFile(p.string());
+        std::string path = root_ + req.path_;
+        std::shared_ptr<const detail::AssetCache::Asset> asset;
+        if ( cache_ ) asset = cache_->get(path);
+
+        const std::string &accept_encoding = req.SERVER_.get("Accept-Encoding");
+
+        bool found = true;
+        if ( asset ) {
+            // each encoded copy has its own entity tag
+            std::string encoding;
+            std::shared_ptr<detail::FileBody> encoded = asset->select(accept_encoding, encoding);
+            if ( !asset->encoded_.empty() ) resp.headers_.replace("Vary", "Accept-Encoding");
+            if ( encoded )
+                resp.encodeFile(encoded, encoding, asset->mime_);
+            else
+                resp.encodeFile(asset->body_, asset->encoding_, asset->mime_);
+        }
+        else if ( fs::exists(path) )
+            encodeLargeFile(path, accept_encoding, resp);
+        else
+            found = false;
+
+        // the client already has the file or asks for parts of it
+        if ( found && !resp.notModified(req) )
+            resp.sendRanges(req);
     }
 
     chain.next(req, resp);
@@ -25,8 +25,8 @@ FileSystemSessionHandler::FileSystemSessionHandler(const std::string &db_file) {
         if ( !fs::exists(p) ) {
             boost::system::error_code ec;
             fs::create_directories(p.parent_path(), ec);
-            db_.open("sqlite:" + p.native() + ";mode=rc;mutex=full" );
         }
+        db_.open("sqlite:db=" + p.native() + ";mode=rc;mutex=full" );
     }
 
     db_.execute("PRAGMA auto_vacuum = 1");
@@ -135,13 +135,17 @@ void FileSystemSessionHandler::deserializeData(const string &data, Dictionary &d
     }
 }
 
+uint64_t FileSystemSessionHandler::timestamp() {
+    return std::chrono::system_clock::now().time_since_epoch().count();
+}
+
 bool FileSystemSessionHandler::writeSessionData(const string &id, const string &data){
     try {
         Transaction trans(db_);
         Statement cmd(db_, "REPLACE INTO sessions (sid, data, ts) VALUES (?, ?, ?)",
                           id,
                           Blob(data.data(), data.size()),
-                          (uint64_t)std::chrono::system_clock::now().time_since_epoch().count());
+                          timestamp());
         cmd.exec();
         trans.commit();
 
@@ -151,13 +155,14 @@ bool FileSystemSessionHandler::writeSessionData(const string &id, const string &
     }
 }
 
-bool FileSystemSessionHandler::readSessionData(const string &id, string &data){
+bool FileSystemSessionHandler::readSessionData(const string &id, string &data, uint64_t &ts){
     try {
-        Query q(db_, "SELECT data FROM sessions WHERE sid = ? LIMIT 1", id);
+        Query q(db_, "SELECT data, ts FROM sessions WHERE sid = ? LIMIT 1", id);
         QueryResult res = q.exec();
         if ( res.next() ) {
             Blob bdata = res.get<Blob>(0);
             data.assign(bdata.data(), bdata.size());
+            ts = res.get<uint64_t>(1);
             return true;
         }
 
@@ -182,9 +187,22 @@ bool FileSystemSessionHandler::write(const Session &session) {
 
 bool FileSystemSessionHandler::read(Session &session) {
     string id = session.id(), data;
-    if ( !readSessionData(id, data) ) return false;
+    uint64_t ts;
+    if ( !readSessionData(id, data, ts) ) return false;
     deserializeData(data, session.data());
+
+    // sessions are only written when changed, keep the ones in use from being collected
+    static const uint64_t refresh_interval = std::chrono::duration_cast<std::chrono::system_clock::duration>(std::chrono::minutes(1)).count();
+    if ( timestamp() - ts > refresh_interval ) {
+        try {
+            Statement(db_, "UPDATE sessions SET ts = ? WHERE sid = ?", timestamp(), id).exec();
+        } catch ( Exception &e ) {
+            cerr << e.what() << endl;
+        }
+    }
+
     gc();
+    return true;
 }
 
 // php like session garbage collection
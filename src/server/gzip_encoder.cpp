@@ -0,0 +1,68 @@
+#include <wspp/server/detail/gzip_encoder.hpp>
+#include <wspp/util/zstream.hpp>
+
+namespace wspp {
+namespace server {
+namespace detail {
+
+// space added to the output for each round of compression of a piece
+static const std::size_t output_step = 16 * 1024;
+
+GzipEncoder::GzipEncoder(int level) {
+    strm_.zalloc = Z_NULL;
+    strm_.zfree = Z_NULL;
+    strm_.opaque = Z_NULL;
+
+    // 15 + 16 selects the largest window and the gzip header
+    int ret = deflateInit2(&strm_, level, Z_DEFLATED, 15 + 16, 8, Z_DEFAULT_STRATEGY);
+    if ( ret != Z_OK ) throw util::Exception(&strm_, ret);
+}
+
+GzipEncoder::~GzipEncoder() {
+    deflateEnd(&strm_);
+}
+
+void GzipEncoder::compress(const char *data, std::size_t size, std::string &out, bool finish) {
+    strm_.next_in = reinterpret_cast<Bytef *>(const_cast<char *>(data));
+    strm_.avail_in = size;
+
+    int flush = finish ? Z_FINISH : Z_NO_FLUSH;
+    std::size_t used = out.size();
+
+    while ( true ) {
+        out.resize(used + output_step);
+        strm_.next_out = reinterpret_cast<Bytef *>(&out[used]);
+        strm_.avail_out = output_step;
+
+        int ret = deflate(&strm_, flush);
+        if ( ret == Z_STREAM_ERROR ) throw util::Exception(&strm_, ret);
+
+        used += output_step - strm_.avail_out;
+
+        // done when all input is consumed and, at the end, all output is flushed
+        if ( finish ? ret == Z_STREAM_END : ( strm_.avail_in == 0 && strm_.avail_out != 0 ) ) break;
+    }
+
+    out.resize(used);
+}
+
+void GzipEncoder::compress(const char *data, std::size_t size, std::string &out, int level) {
+    GzipEncoder encoder(level);
+
+    // the bound of the compressed size allows compressing in a single round
+    out.resize(deflateBound(&encoder.strm_, size));
+
+    encoder.strm_.next_in = reinterpret_cast<Bytef *>(const_cast<char *>(data));
+    encoder.strm_.avail_in = size;
+    encoder.strm_.next_out = reinterpret_cast<Bytef *>(&out[0]);
+    encoder.strm_.avail_out = out.size();
+
+    int ret = deflate(&encoder.strm_, Z_FINISH);
+    if ( ret != Z_STREAM_END ) throw util::Exception(&encoder.strm_, ret);
+
+    out.resize(out.size() - encoder.strm_.avail_out);
+}
+
+} // namespace detail
+} // namespace server
+} // namespace wspp
@@ -0,0 +1,147 @@
+#include <wspp/server/header_map.hpp>
+
+#include <algorithm>
+#include <cstring>
+#include <strings.h>
+
+using namespace std;
+
+namespace wspp {
+namespace server {
+
+// Well known headers, the id of each header is its position in the list plus one
+static const char *well_known_headers[] = {
+    "Accept", "Accept-Charset", "Accept-Encoding", "Accept-Language", "Accept-Ranges",
+    "Access-Control-Allow-Origin", "Authorization", "Cache-Control", "Connection", "Content-Disposition",
+    "Content-Encoding", "Content-Language", "Content-Length", "Content-Range", "Content-Type", "Cookie", "Date",
+    "ETag", "Expect", "Expires", "Host", "If-Match", "If-Modified-Since", "If-None-Match", "If-Range",
+    "If-Unmodified-Since", "Keep-Alive", "Last-Modified", "Location", "Origin", "Pragma", "Range", "Referer",
+    "Server", "Set-Cookie", "Transfer-Encoding", "Upgrade", "User-Agent", "Vary", "X-Forwarded-For",
+    "X-Requested-With"
+};
+
+static const size_t num_well_known_headers = sizeof(well_known_headers)/sizeof(well_known_headers[0]);
+
+// case-insensitive FNV-1a
+static uint32_t hash_name(const char *name, size_t len) {
+    uint32_t h = 2166136261u;
+    for( size_t i = 0 ; i < len ; i++ ) {
+        unsigned char c = name[i];
+        if ( c >= 'A' && c <= 'Z' ) c += 'a' - 'A';
+        h = ( h ^ c ) * 16777619u;
+    }
+    return h;
+}
+
+// open addressing table from name hash to header id
+struct WellKnownHeaderTable {
+    static const size_t table_size = 256; // power of two, larger than 2 * num_well_known_headers
+
+    WellKnownHeaderTable() {
+        memset(slots_, 0, sizeof(slots_));
+        for( size_t i = 0 ; i < num_well_known_headers ; i++ ) {
+            const char *name = well_known_headers[i];
+            size_t pos = hash_name(name, strlen(name)) & ( table_size - 1 );
+            while ( slots_[pos] ) pos = ( pos + 1 ) & ( table_size - 1 );
+            slots_[pos] = i + 1;
+        }
+    }
+
+    uint8_t lookup(const char *name, size_t len) const {
+        size_t pos = hash_name(name, len) & ( table_size - 1 );
+        while ( uint8_t id = slots_[pos] ) {
+            const char *candidate = well_known_headers[id - 1];
+            if ( strlen(candidate) == len && strncasecmp(candidate, name, len) == 0 ) return id;
+            pos = ( pos + 1 ) & ( table_size - 1 );
+        }
+        return 0;
+    }
+
+    uint8_t slots_[table_size];
+};
+
+uint8_t HeaderMap::id(const char *name, size_t len) {
+    static const WellKnownHeaderTable table;
+    return table.lookup(name, len);
+}
+
+HeaderMap::HeaderMap(std::initializer_list<std::pair<std::string, std::string>> init) {
+    for( const auto &h: init )
+        append(h.first, h.second);
+}
+
+size_t HeaderMap::indexOf(const char *name, size_t len) const {
+    uint8_t hid = id(name, len);
+
+    for( size_t i = 0 ; i < size_ ; i++ ) {
+        if ( headers_[i].id_ != hid ) continue;
+        if ( hid ) return i;
+
+        const string &key = headers_[i].first;
+        if ( key.size() == len && strncasecmp(key.data(), name, len) == 0 ) return i;
+    }
+
+    return size_;
+}
+
+void HeaderMap::add(const string &name, const string &val) {
+    if ( !contains(name) )
+        append(name, val);
+}
+
+void HeaderMap::append(const string &name, const string &val) {
+    uint8_t hid = id(name.data(), name.size());
+
+    if ( size_ < headers_.size() ) {
+        // overwrite a cleared entry reusing the memory of its strings
+        value_type &h = headers_[size_];
+        h.first.assign(name);
+        h.second.assign(val);
+        h.id_ = hid;
+    }
+    else {
+        if ( headers_.empty() ) headers_.reserve(initial_capacity);
+        headers_.emplace_back(name, val, hid);
+    }
+
+    ++size_;
+}
+
+void HeaderMap::replace(const string &name, const string &val) {
+    iterator it = find(name);
+    if ( it != end() ) it->second.assign(val);
+    else append(name, val);
+}
+
+void HeaderMap::remove(const string &name) {
+    size_t i;
+    while ( ( i = indexOf(name.data(), name.size()) ) < size_ ) {
+        // move the entry after the headers in use
+        std::rotate(headers_.begin() + i, headers_.begin() + i + 1, headers_.begin() + size_);
+        --size_;
+    }
+}
+
+string HeaderMap::get(const string &name, const string &defaultVal) const {
+    const_iterator it = find(name);
+    return ( it == end() ) ? defaultVal : it->second;
+}
+
+string &HeaderMap::operator[] (const string &name) {
+    iterator it = find(name);
+    if ( it != end() ) return it->second;
+
+    append(name, string());
+    return headers_[size_ - 1].second;
+}
+
+HeaderMap::iterator HeaderMap::find(const string &name) {
+    return headers_.begin() + indexOf(name.data(), name.size());
+}
+
+HeaderMap::const_iterator HeaderMap::find(const string &name) const {
+    return headers_.begin() + indexOf(name.data(), name.size());
+}
+
+} // namespace server
+} // namespace wspp
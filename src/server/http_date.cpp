@@ -0,0 +1,57 @@
+#include <wspp/server/detail/http_date.hpp>
+
+#include <atomic>
+#include <cstring>
+
+namespace wspp {
+namespace server {
+namespace detail {
+
+// The current date is written to the next of several slots which is then published, so that readers copying the
+// previous slot are not disturbed unless they take longer than a few seconds.
+static const std::size_t num_slots = 8;
+static char date_slots[num_slots][HttpDate::size + 1];
+static std::atomic<std::size_t> current_slot(0);
+static std::atomic<time_t> current_time(0);
+
+void HttpDate::format(time_t t, char *buf) {
+    struct tm tm;
+    gmtime_r(&t, &tm);
+    strftime(buf, size + 1, "%a, %d %b %Y %H:%M:%S GMT", &tm);
+}
+
+bool HttpDate::parse(const std::string &date, time_t &t) {
+    struct tm tm = {};
+    const char *end = strptime(date.c_str(), "%a, %d %b %Y %H:%M:%S GMT", &tm);
+    if ( end == nullptr || *end != 0 ) return false;
+
+    t = timegm(&tm);
+    return true;
+}
+
+void HttpDate::update() {
+    time_t now = time(nullptr);
+    time_t prev = current_time.load(std::memory_order_relaxed);
+
+    // only one thread formats each second
+    if ( now == prev || !current_time.compare_exchange_strong(prev, now, std::memory_order_relaxed) ) return;
+
+    std::size_t slot = (current_slot.load(std::memory_order_relaxed) + 1) % num_slots;
+    format(now, date_slots[slot]);
+    current_slot.store(slot, std::memory_order_release);
+}
+
+void HttpDate::appendHeader(std::string &buf) {
+    buf.append("Date: ", 6);
+    buf.append(date_slots[current_slot.load(std::memory_order_acquire)], size);
+    buf.append("\r\n", 2);
+}
+
+// the date is valid before the timer of the server first runs
+static struct InitialDate {
+    InitialDate() { HttpDate::update(); }
+} initial_date;
+
+} // namespace detail
+} // namespace server
+} // namespace wspp
@@ -15,6 +15,11 @@
 #include <boost/bind.hpp>
 #include <boost/shared_ptr.hpp>
 
+#ifdef __linux__
+#include <pthread.h>
+#include <sched.h>
+#endif
+
 namespace wspp {
 namespace server {
 namespace detail {
@@ -33,12 +38,26 @@ io_service_pool::io_service_pool(std::size_t pool_size)
     }
 }
 
-void io_service_pool::run(){
+static void pin_thread_to_cpu(boost::thread &thread, std::size_t index) {
+#ifdef __linux__
+    unsigned int num_cpus = boost::thread::hardware_concurrency();
+    if ( num_cpus == 0 ) return;
+
+    cpu_set_t cpuset;
+    CPU_ZERO(&cpuset);
+    CPU_SET(index % num_cpus, &cpuset);
+    pthread_setaffinity_np(thread.native_handle(), sizeof(cpu_set_t), &cpuset);
+#endif
+}
+
+void io_service_pool::run(bool pin_threads){
     // Create a pool of threads to run all of the io_services.
     std::vector<boost::shared_ptr<boost::thread> > threads;
     for (std::size_t i = 0; i < io_services_.size(); ++i) {
         boost::shared_ptr<boost::thread> thread(new boost::thread(
                                                     boost::bind(&boost::asio::io_service::run, io_services_[i])));
+        if ( pin_threads )
+            pin_thread_to_cpu(*thread, i);
         threads.push_back(thread);
     }
 
@@ -53,13 +72,17 @@ void io_service_pool::stop(){
         io_services_[i]->stop();
 }
 
-boost::asio::io_service& io_service_pool::get_io_service(){
+std::size_t io_service_pool::next_index(){
     // Use a round-robin scheme to choose the next io_service to use.
-    boost::asio::io_service& io_service = *io_services_[next_io_service_];
-    ++next_io_service_;
-    if (next_io_service_ == io_services_.size())
-        next_io_service_ = 0;
-    return io_service;
+    return next_io_service_++ % io_services_.size();
+}
+
+boost::asio::io_service& io_service_pool::get_io_service(){
+    return *io_services_[next_index()];
+}
+
+boost::asio::io_service& io_service_pool::get_io_service(std::size_t index){
+    return *io_services_[index];
 }
 } // namespace detail
 } // namespace server
@@ -0,0 +1,350 @@
+#include <wspp/server/memory_session_handler.hpp>
+#include <wspp/server/session.hpp>
+#include <wspp/database/transaction.hpp>
+
+#include <functional>
+#include <iostream>
+#include <vector>
+
+using namespace std;
+using namespace wspp::util;
+using namespace wspp::db;
+
+namespace wspp {
+namespace server {
+
+// approximate memory taken by a session besides its data
+static const size_t entry_overhead = 256;
+// approximate memory taken by an item of the session data besides its key and value
+static const size_t item_overhead = 64;
+// sessions are expired at most this often
+static const auto expiry_interval = std::chrono::seconds(30);
+
+static size_t session_cost(const string &sid, const Dictionary &data) {
+    size_t cost = entry_overhead + sid.size();
+    for( const auto &p: data )
+        cost += item_overhead + p.first.size() + p.second.size();
+    return cost;
+}
+
+MemorySessionHandler::MemorySessionHandler(const string &db_file, size_t max_memory, std::chrono::seconds ttl,
+                                           std::chrono::milliseconds flush_interval):
+    FileSystemSessionHandler(db_file), max_shard_memory_(max_memory / num_shards), ttl_(ttl),
+    flush_interval_(flush_interval), timer_(io_service_), last_expiry_(Clock::now()) {
+    schedule();
+    thread_ = boost::thread([this] { io_service_.run(); });
+}
+
+MemorySessionHandler::~MemorySessionHandler() {
+    // the timer may be re-armed by a flush running meanwhile, so the loop is stopped rather than the timer cancelled
+    io_service_.stop();
+    thread_.join();
+
+    flush();
+}
+
+MemorySessionHandler::Shard &MemorySessionHandler::shard(const string &sid) {
+    return shards_[std::hash<string>()(sid) % num_shards];
+}
+
+void MemorySessionHandler::schedule() {
+    timer_.expires_from_now(flush_interval_);
+    timer_.async_wait([this] (const boost::system::error_code &e) {
+        if ( e == boost::asio::error::operation_aborted ) return;
+
+        flush();
+
+        if ( Clock::now() - last_expiry_ >= expiry_interval ) {
+            expire();
+            last_expiry_ = Clock::now();
+        }
+
+        schedule();
+    });
+}
+
+// called with the shard locked
+MemorySessionHandler::Entry &MemorySessionHandler::insert(Shard &shard, const string &sid, Entry &&entry) {
+    auto res = shard.entries_.emplace(sid, std::move(entry));
+    Entry &e = res.first->second;
+
+    shard.lru_.push_front(sid);
+    e.lru_ = shard.lru_.begin();
+    shard.cost_ += e.cost_;
+
+    return e;
+}
+
+// the session in memory, moved back from the evicted sessions if it was evicted before its changes were written, or
+// null. Called with the shard locked.
+MemorySessionHandler::Entry *MemorySessionHandler::find(Shard &shard, const string &sid) {
+    auto it = shard.entries_.find(sid);
+    if ( it != shard.entries_.end() ) return &it->second;
+
+    auto eit = shard.evicted_.find(sid);
+    if ( eit == shard.evicted_.end() ) return nullptr;
+
+    insert(shard, sid, std::move(eit->second));
+    shard.evicted_.erase(eit);
+    evict(shard);
+
+    // the entry just inserted is the most recently used and is never evicted
+    return &shard.entries_.find(sid)->second;
+}
+
+// called with the shard locked
+void MemorySessionHandler::evict(Shard &shard) {
+    while ( shard.cost_ > max_shard_memory_ && shard.lru_.size() > 1 ) {
+        auto it = shard.entries_.find(shard.lru_.back());
+        Entry &e = it->second;
+
+        shard.lru_.pop_back();
+        shard.cost_ -= e.cost_;
+
+        // the changes are kept until they are written, the database has the latest data of clean sessions
+        if ( e.version_ != e.stored_version_ )
+            shard.evicted_[it->first] = std::move(e);
+
+        shard.entries_.erase(it);
+    }
+}
+
+bool MemorySessionHandler::load(const string &sid, Dictionary &data, uint64_t &ts) {
+    boost::unique_lock<boost::mutex> lock(db_mutex_);
+
+    try {
+        Query q(db_, "SELECT data, ts FROM sessions WHERE sid = ? LIMIT 1", sid);
+        QueryResult res = q.exec();
+        if ( !res.next() ) return false;
+
+        Blob bdata = res.get<Blob>(0);
+        deserializeData(string(bdata.data(), bdata.size()), data);
+        ts = res.get<uint64_t>(1);
+        return true;
+    } catch ( Exception &e ) {
+        cerr << e.what() << endl;
+        return false;
+    }
+}
+
+bool MemorySessionHandler::read(Session &session) {
+    const string &sid = session.id();
+    Shard &s = shard(sid);
+    auto now = Clock::now();
+
+    {
+        boost::unique_lock<boost::mutex> lock(s.mutex_);
+
+        if ( Entry *e = find(s, sid) ) {
+            if ( now - e->accessed_ > ttl_ ) return false;
+
+            e->accessed_ = now;
+            s.lru_.splice(s.lru_.begin(), s.lru_, e->lru_);
+            session.data() = e->data_;
+            return true;
+        }
+    }
+
+    // not in memory, the database is not queried with the shard locked
+    Entry entry;
+    if ( !load(sid, entry.data_, entry.stored_ts_) ) return false;
+
+    if ( timestamp() - entry.stored_ts_ >
+         (uint64_t)std::chrono::duration_cast<std::chrono::system_clock::duration>(ttl_).count() )
+        return false;
+
+    entry.cost_ = session_cost(sid, entry.data_);
+    entry.accessed_ = now;
+
+    boost::unique_lock<boost::mutex> lock(s.mutex_);
+
+    // another request of the session may have loaded or changed it meanwhile (and it may have been evicted since), in
+    // which case the data in memory is newer than the data just loaded
+    Entry *e = find(s, sid);
+    if ( !e ) {
+        e = &insert(s, sid, std::move(entry));
+        evict(s);
+    }
+
+    session.data() = e->data_;
+    return true;
+}
+
+bool MemorySessionHandler::write(const Session &session) {
+    const string &sid = session.id();
+    Shard &s = shard(sid);
+
+    boost::unique_lock<boost::mutex> lock(s.mutex_);
+
+    Entry *found = find(s, sid);
+    Entry &e = found ? *found : insert(s, sid, Entry());
+    e.data_ = session.data();
+    e.version_++;
+    e.accessed_ = Clock::now();
+    s.lru_.splice(s.lru_.begin(), s.lru_, e.lru_);
+
+    size_t cost = session_cost(sid, e.data_);
+    s.cost_ = s.cost_ - e.cost_ + cost;
+    e.cost_ = cost;
+
+    evict(s);
+    return true;
+}
+
+string MemorySessionHandler::uniqueSID() {
+    // session ids are random so a collision is unlikely, it is still checked for since the id is the key of the data
+    for( int tries = 0 ; tries < 4 ; tries++ ) {
+        string sid = generateSID();
+        if ( sid.empty() ) continue;
+
+        {
+            Shard &s = shard(sid);
+            boost::unique_lock<boost::mutex> lock(s.mutex_);
+            if ( s.entries_.count(sid) || s.evicted_.count(sid) ) continue;
+        }
+
+        boost::unique_lock<boost::mutex> lock(db_mutex_);
+        Query q(db_, "SELECT sid FROM sessions WHERE sid = ? LIMIT 1", sid);
+        if ( !q.exec().next() ) return sid;
+    }
+
+    return string();
+}
+
+void MemorySessionHandler::flush() {
+    struct Pending {
+        string sid_;
+        // empty for sessions that only need their timestamp refreshed
+        string data_;
+        bool changed_;
+        uint64_t version_;
+    };
+
+    // sessions in use for a fraction of the ttl have their timestamp refreshed so that they are not expired
+    auto now = Clock::now();
+    uint64_t ts = timestamp();
+    uint64_t refresh = std::chrono::duration_cast<std::chrono::system_clock::duration>(ttl_).count() / 4;
+
+    // the data is copied with each shard locked in turn and written with no shard locked
+    vector<vector<Pending>> pending(num_shards);
+    bool empty = true;
+    for( size_t i = 0 ; i < num_shards ; i++ ) {
+        Shard &s = shards_[i];
+        boost::unique_lock<boost::mutex> lock(s.mutex_);
+
+        for( const auto &p: s.evicted_ )
+            pending[i].push_back(Pending{p.first, serializeData(p.second.data_), true, p.second.version_});
+
+        for( const auto &p: s.entries_ ) {
+            const Entry &e = p.second;
+            if ( e.version_ != e.stored_version_ )
+                pending[i].push_back(Pending{p.first, serializeData(e.data_), true, e.version_});
+            else if ( ts - e.stored_ts_ > refresh && now - e.accessed_ < ttl_ )
+                pending[i].push_back(Pending{p.first, string(), false, e.version_});
+        }
+
+        empty = empty && pending[i].empty();
+    }
+
+    if ( empty ) return;
+
+    try {
+        boost::unique_lock<boost::mutex> lock(db_mutex_);
+
+        Transaction trans(db_);
+        Statement replace(db_, "REPLACE INTO sessions (sid, data, ts) VALUES (?, ?, ?)");
+        Statement touch(db_, "UPDATE sessions SET ts = ? WHERE sid = ?");
+
+        for( const auto &shard_pending: pending ) {
+            for( const Pending &p: shard_pending ) {
+                if ( p.changed_ ) {
+                    replace.clear();
+                    replace(p.sid_, Blob(p.data_.data(), p.data_.size()), ts);
+                }
+                else {
+                    touch.clear();
+                    touch(ts, p.sid_);
+                }
+            }
+        }
+
+        trans.commit();
+    } catch ( Exception &e ) {
+        cerr << e.what() << endl;
+        return;
+    }
+
+    // the sessions changed meanwhile stay dirty
+    for( size_t i = 0 ; i < num_shards ; i++ ) {
+        Shard &s = shards_[i];
+        boost::unique_lock<boost::mutex> lock(s.mutex_);
+
+        for( const Pending &p: pending[i] ) {
+            auto it = s.entries_.find(p.sid_);
+            if ( it != s.entries_.end() ) {
+                if ( it->second.version_ == p.version_ ) {
+                    it->second.stored_version_ = p.version_;
+                    it->second.stored_ts_ = ts;
+                }
+                continue;
+            }
+
+            auto eit = s.evicted_.find(p.sid_);
+            if ( eit != s.evicted_.end() && eit->second.version_ == p.version_ )
+                s.evicted_.erase(eit);
+        }
+    }
+}
+
+void MemorySessionHandler::expire() {
+    auto now = Clock::now();
+
+    for( Shard &s: shards_ ) {
+        boost::unique_lock<boost::mutex> lock(s.mutex_);
+
+        for( auto it = s.entries_.begin() ; it != s.entries_.end() ; ) {
+            if ( now - it->second.accessed_ > ttl_ ) {
+                s.cost_ -= it->second.cost_;
+                s.lru_.erase(it->second.lru_);
+                it = s.entries_.erase(it);
+            }
+            else ++it;
+        }
+
+        for( auto it = s.evicted_.begin() ; it != s.evicted_.end() ; ) {
+            if ( now - it->second.accessed_ > ttl_ ) it = s.evicted_.erase(it);
+            else ++it;
+        }
+    }
+
+    // the timestamps of sessions in use are refreshed by flush
+    uint64_t oldest = timestamp() - std::chrono::duration_cast<std::chrono::system_clock::duration>(ttl_).count();
+
+    try {
+        boost::unique_lock<boost::mutex> lock(db_mutex_);
+        Statement(db_, "DELETE FROM sessions WHERE ts < ?", oldest).exec();
+    } catch ( Exception &e ) {
+        cerr << e.what() << endl;
+    }
+}
+
+size_t MemorySessionHandler::size() const {
+    size_t n = 0;
+    for( const Shard &s: shards_ ) {
+        boost::unique_lock<boost::mutex> lock(s.mutex_);
+        n += s.entries_.size();
+    }
+    return n;
+}
+
+size_t MemorySessionHandler::memory() const {
+    size_t n = 0;
+    for( const Shard &s: shards_ ) {
+        boost::unique_lock<boost::mutex> lock(s.mutex_);
+        n += s.cost_;
+    }
+    return n;
+}
+
+} // namespace server
+} // namespace wspp
@@ -0,0 +1,255 @@
+#include <wspp/server/metrics.hpp>
+
+#include <sstream>
+
+using namespace std;
+
+namespace wspp {
+namespace server {
+namespace detail {
+
+static std::atomic<std::size_t> next_series_id(0);
+
+template <class Series>
+ThreadSeries<Series>::ThreadSeries(): id_(next_series_id++) {
+}
+
+template <class Series>
+typename ThreadSeries<Series>::Shard &ThreadSeries<Series>::localShard() {
+    // shards of the calling thread indexed by id_, ids are never reused so stale entries are never looked up
+    static thread_local std::vector<void *> local_shards;
+
+    if ( id_ < local_shards.size() && local_shards[id_] )
+        return *static_cast<Shard *>(local_shards[id_]);
+
+    Shard *shard = new Shard();
+    {
+        boost::unique_lock<boost::mutex> lock(mutex_);
+        shards_.emplace_back(shard);
+    }
+
+    if ( id_ >= local_shards.size() ) local_shards.resize(id_ + 1, nullptr);
+    local_shards[id_] = shard;
+    return *shard;
+}
+
+template <class Series>
+Series &ThreadSeries<Series>::local(const std::string &key) {
+    Shard &shard = localShard();
+
+    // only this thread adds series to its shard, so it may look them up without locking
+    auto it = shard.series_.find(key);
+    if ( it != shard.series_.end() ) return *it->second;
+
+    boost::unique_lock<boost::mutex> lock(shard.mutex_);
+    std::unique_ptr<Series> &series = shard.series_[key];
+    series.reset(new Series());
+    return *series;
+}
+
+template <class Series>
+template <class F>
+void ThreadSeries<Series>::forEach(F f) const {
+    boost::unique_lock<boost::mutex> lock(mutex_);
+    for( const auto &shard: shards_ ) {
+        boost::unique_lock<boost::mutex> shard_lock(shard->mutex_);
+        for( const auto &s: shard->series_ )
+            f(s.first, *s.second);
+    }
+}
+
+// only the owner thread writes a series, so a plain load and store is enough to update it
+static inline void add(std::atomic<uint64_t> &value, uint64_t n) {
+    value.store(value.load(std::memory_order_relaxed) + n, std::memory_order_relaxed);
+}
+
+HistogramSeries::HistogramSeries() {
+    for( auto &b: buckets_ ) b.store(0, std::memory_order_relaxed);
+}
+
+std::size_t HistogramSeries::bucket(uint64_t value) {
+    if ( value < 16 ) return value;
+
+    std::size_t e = 4;
+    while ( value >> (e + 1) ) e++;
+    std::size_t b = 16 + (e - 4) * 8 + ((value >> (e - 3)) & 7);
+    return std::min(b, num_buckets - 1);
+}
+
+uint64_t HistogramSeries::upperBound(std::size_t bucket) {
+    if ( bucket < 16 ) return bucket + 1;
+
+    std::size_t e = 4 + (bucket - 16) / 8, sub = (bucket - 16) % 8;
+    return uint64_t(9 + sub) << (e - 3);
+}
+
+} // namespace detail
+
+Metric::Metric(const string &name, const string &help, const string &type, const vector<string> &label_names):
+    name_(name), help_(help), type_(type), label_names_(label_names) {
+}
+
+void Metric::write(ostream &strm) const {
+    strm << "# HELP " << name_ << ' ' << help_ << '\n';
+    strm << "# TYPE " << name_ << ' ' << type_ << '\n';
+    writeSeries(strm);
+}
+
+// label values are separated by a character that does not appear in them
+static const char label_separator = '\x1f';
+
+string Metric::key(const MetricLabels &labels) {
+    string k;
+    for( std::size_t i = 0 ; i < labels.size() ; i++ ) {
+        if ( i ) k += label_separator;
+        k += labels[i];
+    }
+    return k;
+}
+
+string Metric::labels(const string &key, const string &extra) const {
+    string res;
+    std::size_t pos = 0;
+    for( const string &name: label_names_ ) {
+        std::size_t end = key.find(label_separator, pos);
+        if ( end == string::npos ) end = key.size();
+
+        res += res.empty() ? '{' : ',';
+        res += name;
+        res += "=\"";
+        for( std::size_t i = pos ; i < end ; i++ ) {
+            char c = key[i];
+            if ( c == '\\' || c == '"' ) { res += '\\'; res += c; }
+            else if ( c == '\n' ) res += "\\n";
+            else res += c;
+        }
+        res += '"';
+
+        pos = std::min(end + 1, key.size());
+    }
+
+    if ( !extra.empty() ) {
+        res += res.empty() ? '{' : ',';
+        res += extra;
+    }
+
+    if ( !res.empty() ) res += '}';
+    return res;
+}
+
+Counter::Counter(const string &name, const string &help, const vector<string> &label_names):
+    Metric(name, help, "counter", label_names) {
+}
+
+void Counter::inc(const MetricLabels &labels, uint64_t n) {
+    detail::add(series_.local(key(labels)).value_, n);
+}
+
+void Counter::writeSeries(ostream &strm) const {
+    map<string, uint64_t> totals;
+    series_.forEach([&] (const string &key, const detail::CounterSeries &s) {
+        totals[key] += s.value_.load(std::memory_order_relaxed);
+    });
+
+    for( const auto &t: totals )
+        strm << name_ << labels(t.first) << ' ' << t.second << '\n';
+}
+
+Histogram::Histogram(const string &name, const string &help, const vector<string> &label_names):
+    Metric(name, help, "histogram", label_names) {
+}
+
+void Histogram::observe(const MetricLabels &labels, double seconds) {
+    uint64_t us = seconds > 0 ? uint64_t(seconds * 1.0e6) : 0;
+
+    detail::HistogramSeries &s = series_.local(key(labels));
+    detail::add(s.buckets_[detail::HistogramSeries::bucket(us)], 1);
+    detail::add(s.count_, 1);
+    detail::add(s.sum_, us);
+}
+
+void Histogram::writeSeries(ostream &strm) const {
+    struct Totals {
+        uint64_t buckets_[detail::HistogramSeries::num_buckets] = {0};
+        uint64_t count_ = 0, sum_ = 0;
+    };
+
+    map<string, Totals> totals;
+    series_.forEach([&] (const string &key, const detail::HistogramSeries &s) {
+        Totals &t = totals[key];
+        for( std::size_t i = 0 ; i < detail::HistogramSeries::num_buckets ; i++ )
+            t.buckets_[i] += s.buckets_[i].load(std::memory_order_relaxed);
+        t.count_ += s.count_.load(std::memory_order_relaxed);
+        t.sum_ += s.sum_.load(std::memory_order_relaxed);
+    });
+
+    // the recorded buckets are folded into the usual Prometheus boundaries, a bucket counts towards a boundary when
+    // all its values are below it
+    static const char *bounds[] = { "0.0005", "0.001", "0.0025", "0.005", "0.01", "0.025", "0.05", "0.1", "0.25",
+                                    "0.5", "1", "2.5", "5", "10" };
+    static const uint64_t bounds_us[] = { 500, 1000, 2500, 5000, 10000, 25000, 50000, 100000, 250000,
+                                          500000, 1000000, 2500000, 5000000, 10000000 };
+
+    for( const auto &t: totals ) {
+        const Totals &h = t.second;
+        uint64_t cumulative = 0;
+        std::size_t b = 0;
+
+        for( std::size_t i = 0 ; i < sizeof(bounds_us)/sizeof(bounds_us[0]) ; i++ ) {
+            for( ; b < detail::HistogramSeries::num_buckets && detail::HistogramSeries::upperBound(b) - 1 <= bounds_us[i] ; b++ )
+                cumulative += h.buckets_[b];
+            strm << name_ << "_bucket" << labels(t.first, string("le=\"") + bounds[i] + '"') << ' ' << cumulative << '\n';
+        }
+
+        strm << name_ << "_bucket" << labels(t.first, "le=\"+Inf\"") << ' ' << h.count_ << '\n';
+        strm << name_ << "_sum" << labels(t.first) << ' ' << h.sum_ / 1.0e6 << '\n';
+        strm << name_ << "_count" << labels(t.first) << ' ' << h.count_ << '\n';
+    }
+}
+
+SampledMetric::SampledMetric(const string &name, const string &help, const string &type,
+                             const std::function<double ()> &sample):
+    Metric(name, help, type, vector<string>()), sample_(sample) {
+}
+
+void SampledMetric::writeSeries(ostream &strm) const {
+    strm << name_ << ' ' << sample_() << '\n';
+}
+
+template <class M>
+M &MetricsRegistry::add(M *metric) {
+    boost::unique_lock<boost::mutex> lock(mutex_);
+    metrics_.emplace_back(metric);
+    return *metric;
+}
+
+Counter &MetricsRegistry::counter(const string &name, const string &help, const vector<string> &label_names) {
+    return add(new Counter(name, help, label_names));
+}
+
+Histogram &MetricsRegistry::histogram(const string &name, const string &help, const vector<string> &label_names) {
+    return add(new Histogram(name, help, label_names));
+}
+
+void MetricsRegistry::sampledGauge(const string &name, const string &help, const std::function<double ()> &sample) {
+    add(new SampledMetric(name, help, "gauge", sample));
+}
+
+void MetricsRegistry::sampledCounter(const string &name, const string &help, const std::function<double ()> &sample) {
+    add(new SampledMetric(name, help, "counter", sample));
+}
+
+void MetricsRegistry::write(ostream &strm) const {
+    boost::unique_lock<boost::mutex> lock(mutex_);
+    for( const auto &m: metrics_ )
+        m->write(strm);
+}
+
+string MetricsRegistry::scrape() const {
+    ostringstream strm;
+    write(strm);
+    return strm.str();
+}
+
+} // namespace server
+} // namespace wspp
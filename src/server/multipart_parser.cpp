@@ -0,0 +1,334 @@
+#include <wspp/server/detail/multipart_parser.hpp>
+
+#include <boost/filesystem.hpp>
+
+#include <cstring>
+#include <strings.h>
+
+using namespace std;
+
+namespace wspp {
+namespace server {
+namespace detail {
+
+// maximum size of a part header line
+static const size_t max_header_line = 8192;
+
+namespace fs = boost::filesystem;
+static fs::path get_temporary_path(const std::string &dir, const std::string &prefix, const std::string &ext){
+    fs::path directory;
+
+    if ( ! dir.empty() ) directory = dir;
+    else directory = boost::filesystem::temp_directory_path();
+
+    std::string varname ="%%%%-%%%%-%%%%-%%%%";
+
+    if ( !prefix.empty() )
+        directory /= prefix + '-' + varname + '.' + ext;
+    else
+        directory /= "tmp-" + varname + '.' + ext;
+
+    return boost::filesystem::unique_path(directory);
+}
+
+MultipartParser::MultipartParser(const string &boundary, size_t spool_threshold, const string &spool_dir):
+    delimiter_("\r\n--" + boundary), spool_threshold_(spool_threshold), spool_dir_(spool_dir) {
+
+    const size_t m = delimiter_.size();
+    for( size_t i = 0 ; i < 256 ; i++ ) skip_[i] = m;
+    for( size_t i = 0 ; i < m - 1 ; i++ ) skip_[(unsigned char)delimiter_[i]] = m - 1 - i;
+}
+
+MultipartParser::~MultipartParser() {
+    if ( spool_strm_.is_open() ) spool_strm_.close();
+
+    for( const string &path: spooled_files_ ) {
+        boost::system::error_code ec;
+        fs::remove(path, ec);
+    }
+}
+
+bool MultipartParser::isComplete() const {
+    // the closing delimiter may not be followed by CRLF
+    return state_ == Done || ( state_ == Delimiter && buffer_.compare(0, 2, "--") == 0 );
+}
+
+bool MultipartParser::feed(const char *data, size_t size) {
+    const char *p = data, *end = data + size;
+
+    while ( p < end ) {
+        if ( state_ == Body ) {
+            p = parseBody(p, end);
+            if ( !p ) return false;
+            continue;
+        }
+
+        if ( state_ == Done ) break; // ignore the epilogue
+
+        const char *line;
+        size_t len;
+        if ( !readLine(p, end, line, len) ) {
+            if ( buffer_.size() > max_header_line ) return false;
+            break;
+        }
+
+        switch ( state_ ) {
+        case Preamble: {
+            // skip anything before the first boundary, which is not preceded by CRLF
+            const size_t m = delimiter_.size() - 2;
+            if ( len >= m && memcmp(line, delimiter_.data() + 2, m) == 0 )
+                state_ = ( len >= m + 2 && line[m] == '-' && line[m+1] == '-' ) ? Done : Headers;
+            break;
+        }
+        case Delimiter:
+            // a boundary is followed by CRLF or by -- if it is the last one
+            state_ = ( len >= 2 && line[0] == '-' && line[1] == '-' ) ? Done : Headers;
+            break;
+        case Headers:
+            if ( len > 0 )
+                parseHeader(line, len);
+            else if ( field_.empty() )
+                state_ = Done;
+            else {
+                // empty line ends the headers of the part
+                startPart();
+                state_ = Body;
+            }
+            break;
+        default:
+            break;
+        }
+
+        buffer_.clear();
+    }
+
+    return true;
+}
+
+// pass on the part data in [p, end) up to the next delimiter
+const char *MultipartParser::parseBody(const char *p, const char *end) {
+    const size_t m = delimiter_.size();
+
+    // complete a delimiter that started at the end of the previous piece
+    if ( matched_ ) {
+        size_t n = std::min<size_t>(m - matched_, end - p);
+        if ( memcmp(p, delimiter_.data() + matched_, n) == 0 ) {
+            matched_ += n;
+            if ( matched_ < m ) return end;
+
+            matched_ = 0;
+            endPart();
+            state_ = Delimiter;
+            return p + n;
+        }
+
+        // it was part of the data after all
+        if ( !appendPart(delimiter_.data(), matched_) ) return nullptr;
+        matched_ = 0;
+    }
+
+    size_t size = end - p;
+    size_t pos = findDelimiter(p, size);
+
+    if ( pos != string::npos ) {
+        if ( !appendPart(p, pos) ) return nullptr;
+        endPart();
+        state_ = Delimiter;
+        return p + pos + m;
+    }
+
+    // hold back a tail that may be the beginning of a delimiter
+    matched_ = partialDelimiter(p, size);
+    if ( !appendPart(p, size - matched_) ) return nullptr;
+    return end;
+}
+
+// Boyer-Moore-Horspool search of the delimiter
+size_t MultipartParser::findDelimiter(const char *data, size_t size) const {
+    const size_t m = delimiter_.size();
+    if ( size < m ) return string::npos;
+
+    const unsigned char *s = reinterpret_cast<const unsigned char *>(data);
+    const unsigned char last = delimiter_[m - 1];
+
+    for( size_t i = 0 ; i <= size - m ; ) {
+        unsigned char c = s[i + m - 1];
+        if ( c == last && memcmp(s + i, delimiter_.data(), m - 1) == 0 ) return i;
+        i += skip_[c];
+    }
+
+    return string::npos;
+}
+
+// length of the longest suffix of data that is a prefix of the delimiter. The boundary cannot contain CR so
+// a prefix may only start at a CR.
+size_t MultipartParser::partialDelimiter(const char *data, size_t size) const {
+    const size_t m = delimiter_.size();
+    const char *end = data + size;
+    const char *p = ( size < m ) ? data : end - m + 1;
+
+    while ( ( p = static_cast<const char *>(memchr(p, '\r', end - p)) ) != nullptr ) {
+        if ( memcmp(p, delimiter_.data(), end - p) == 0 ) return end - p;
+        ++p;
+    }
+
+    return 0;
+}
+
+// get the next line in [p, end), lines split between pieces are collected in buffer_
+bool MultipartParser::readLine(const char *&p, const char *end, const char *&line, size_t &len) {
+    const char *nl = static_cast<const char *>(memchr(p, '\n', end - p));
+
+    if ( !nl ) {
+        buffer_.append(p, end - p);
+        p = end;
+        return false;
+    }
+
+    if ( buffer_.empty() ) {
+        line = p;
+        len = nl - p;
+    } else {
+        buffer_.append(p, nl - p);
+        line = buffer_.data();
+        len = buffer_.size();
+    }
+
+    p = nl + 1;
+    if ( len > 0 && line[len - 1] == '\r' ) --len;
+
+    return true;
+}
+
+static bool is_space(char c) {
+    return c == ' ' || c == '\t';
+}
+
+static void trim(const char *&p, const char *&end) {
+    while ( p < end && is_space(*p) ) ++p;
+    while ( end > p && is_space(*(end - 1)) ) --end;
+}
+
+static bool iequals(const char *p, const char *end, const char *s) {
+    size_t n = strlen(s);
+    return size_t(end - p) == n && strncasecmp(p, s, n) == 0;
+}
+
+// parse parameters of e.g. Content-Disposition: form-data; name="field"; filename="file.txt"
+static void parse_disposition(const char *p, const char *end, string &name, string &file_name) {
+    bool is_form_data = false;
+
+    while ( p < end ) {
+        const char *key = p, *key_end = p, *val = p, *val_end = p;
+
+        while ( key_end < end && *key_end != '=' && *key_end != ';' ) ++key_end;
+        p = key_end;
+
+        if ( p < end && *p == '=' ) {
+            val = ++p;
+            while ( val < end && is_space(*val) ) ++val;
+
+            if ( val < end && *val == '"' ) {
+                ++val;
+                val_end = static_cast<const char *>(memchr(val, '"', end - val));
+                if ( !val_end ) val_end = end;
+                p = val_end;
+            }
+            else {
+                val_end = val;
+                while ( val_end < end && *val_end != ';' ) ++val_end;
+                p = val_end;
+                trim(val, val_end);
+            }
+
+            while ( p < end && *p != ';' ) ++p;
+        }
+
+        trim(key, key_end);
+
+        if ( key == key_end ) ;
+        else if ( val == val_end && iequals(key, key_end, "form-data") ) is_form_data = true;
+        else if ( is_form_data && iequals(key, key_end, "name") ) name.assign(val, val_end);
+        else if ( is_form_data && iequals(key, key_end, "filename") ) file_name.assign(val, val_end);
+
+        if ( p < end ) ++p; // skip ;
+    }
+}
+
+void MultipartParser::parseHeader(const char *data, size_t size) {
+    const char *end = data + size;
+    const char *colon = static_cast<const char *>(memchr(data, ':', size));
+    if ( !colon ) return;
+
+    const char *key = data, *key_end = colon, *val = colon + 1, *val_end = end;
+    trim(key, key_end);
+    trim(val, val_end);
+
+    if ( iequals(key, key_end, "Content-Disposition") )
+        parse_disposition(val, val_end, field_, file_name_);
+    else if ( iequals(key, key_end, "Content-Type") )
+        content_type_.assign(val, val_end);
+}
+
+void MultipartParser::startPart() {
+    data_.clear();
+    size_ = 0;
+    spool_path_.clear();
+}
+
+bool MultipartParser::appendPart(const char *data, size_t size) {
+    size_ += size;
+
+    if ( !file_name_.empty() && spool_threshold_ > 0 && spool_path_.empty() && size_ > spool_threshold_ ) {
+        // the upload became too large to keep in memory, continue in a temporary file
+        spool_path_ = get_temporary_path(spool_dir_, "up", "tmp").string();
+        spooled_files_.push_back(spool_path_);
+
+        spool_strm_.open(spool_path_, ios::binary | ios::trunc);
+        spool_strm_.write(data_.data(), data_.size());
+        data_.clear();
+        data_.shrink_to_fit();
+    }
+
+    if ( spool_path_.empty() ) data_.append(data, size);
+    else spool_strm_.write(data, size);
+
+    return spool_path_.empty() || spool_strm_.good();
+}
+
+void MultipartParser::endPart() {
+    if ( file_name_.empty() )
+        fields_[field_] = std::move(data_);
+    else {
+        if ( spool_strm_.is_open() ) spool_strm_.close();
+
+        Request::UploadedFile file_info;
+
+        file_info.mime_ = content_type_;
+        file_info.name_ = file_name_;
+        file_info.path_ = spool_path_;
+        file_info.data_ = std::move(data_);
+        file_info.size_ = size_;
+
+        files_.insert({field_, std::move(file_info)});
+    }
+
+    field_.clear();
+    file_name_.clear();
+    content_type_.clear();
+}
+
+void MultipartParser::decode(Request &req) {
+    for( auto &field: fields_ )
+        req.POST_[field.first] = std::move(field.second);
+
+    for( auto &file: files_ )
+        req.FILE_.insert(std::move(file));
+
+    fields_.clear();
+    files_.clear();
+}
+
+} // namespace detail
+} // namespace server
+} // namespace wspp
@@ -1,35 +1,74 @@
 #include <wspp/server/request.hpp>
 #include <wspp/server/route.hpp>
 
-#include <boost/thread.hpp>
 #include <boost/algorithm/string.hpp>
 #include <boost/tokenizer.hpp>
 
+#include <unordered_map>
+#include <memory>
+
 using namespace std;
 namespace wspp {
 namespace server {
+// Routes given by their pattern are compiled on first use and kept by each thread, so that matching neither compiles
+// a regular expression nor takes a lock. Patterns are expected to be constants of the application.
+static const Route &route_of(const string &pattern) {
+    static thread_local std::unordered_map<string, std::unique_ptr<Route>> routes;
+
+    std::unique_ptr<Route> &route = routes[pattern];
+    if ( !route ) route.reset(new Route(pattern));
+    return *route;
+}
+
 bool Request::matches(const string &method, const string &pattern, Dictionary &attributes) const{
-    return matchesMethod(method) && Route(pattern).matches(path_, attributes);
+    return matchesMethod(method) && matchesRoute(route_of(pattern), attributes);
 }
 
 bool Request::matches(const string &method, const string &pattern) const{
     Dictionary attributes;
-    return matchesMethod(method) && Route(pattern).matches(path_, attributes);
+    return matchesMethod(method) && matchesRoute(route_of(pattern), attributes);
 }
 
 bool Request::matches(const string &method, const Route &pattern, Dictionary &attributes) const{
-    return matchesMethod(method) && pattern.matches(path_, attributes);
+    return matchesMethod(method) && matchesRoute(pattern, attributes);
 }
 
 bool Request::matches(const string &method, const Route &pattern) const{
     Dictionary attributes;
-    return matchesMethod(method) && pattern.matches(path_, attributes);
+    return matchesMethod(method) && matchesRoute(pattern, attributes);
+}
+
+void Request::clear() {
+    SERVER_.clear();
+    GET_.clear();
+    POST_.clear();
+    COOKIE_.clear();
+    FILE_.clear();
+    content_.clear();
+    content_type_.clear();
+    method_.clear();
+    path_.clear();
+    query_.clear();
+    protocol_.clear();
+    route_.clear();
+}
+
+bool Request::matchesRoute(const Route &route, Dictionary &attributes) const{
+    if ( !route.matches(path_, attributes) ) return false;
+    route_ = route.pattern();
+    return true;
 }
 
 bool Request::matchesMethod(const string &method) const{
-    vector<string> methods;
-    boost::split( methods, method, boost::is_any_of(" |"), boost::token_compress_on );
-    return std::find(methods.begin(), methods.end(), method_) != methods.end();
+    // methods are separated by | or spaces
+    size_t pos = 0;
+    while ( pos < method.size() ) {
+        size_t end = method.find_first_of(" |", pos);
+        if ( end == string::npos ) end = method.size();
+        if ( end > pos && method.compare(pos, end - pos, method_) == 0 ) return true;
+        pos = end + 1;
+    }
+    return false;
 }
 } // namespace server
 } // namespace wspp
\ No newline at end of file
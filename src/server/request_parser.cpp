@@ -15,16 +15,12 @@
 #include <wspp/server/request.hpp>
 
 #include <algorithm>
+#include <cctype>
 #include <cstring>
 #include <utility>
-#include <fstream>
+#include <climits>
 
 #include <boost/algorithm/string.hpp>
-#include <boost/filesystem.hpp>
-#include <boost/regex.hpp>
-#include <boost/algorithm/string.hpp>
-#include <boost/tokenizer.hpp>
-#include <boost/iostreams/stream.hpp>
 
 using namespace std;
 using namespace wspp::server;
@@ -32,7 +28,8 @@ using namespace wspp::server;
 namespace wspp {
 namespace server {
 namespace detail {
-RequestParser::RequestParser(){
+RequestParser::RequestParser(uint64_t max_body_size, size_t upload_spool_size, const string &upload_dir):
+    max_body_size_(max_body_size), upload_spool_size_(upload_spool_size), upload_dir_(upload_dir) {
     memset(&settings_, 0, sizeof(settings_));
     settings_.on_url = &on_url;
 
@@ -55,6 +52,13 @@ void RequestParser::reset(){
     current_header_field_.clear();
     current_header_value_.clear();
     body_.clear();
+    protocol_.clear();
+    headers_.clear();
+    is_complete_ = false;
+    headers_complete_ = false;
+    body_size_ = 0;
+    body_too_large_ = false;
+    multipart_.reset();
 }
 
 int RequestParser::on_message_begin(http_parser *parser){
@@ -78,7 +82,7 @@ int RequestParser::on_message_complete(http_parser * parser){
 int RequestParser::on_header_field(http_parser *parser, const char *data, size_t size){
     RequestParser &rp = *static_cast<RequestParser*>(parser->data);
     if ( !rp.current_header_value_.empty() ) {
-        rp.headers_[rp.current_header_field_] = rp.current_header_value_;
+        rp.headers_.replace(rp.current_header_field_, rp.current_header_value_);
         rp.current_header_field_.clear();
         rp.current_header_value_.clear();
     }
@@ -92,10 +96,24 @@ int RequestParser::on_header_value(http_parser *parser, const char *data, size_t
     return 0;
 }
 
+// get the boundary parameter of a multipart/form-data content type
+static bool multipart_boundary(const string &content_type, string &boundary) {
+    if ( !boost::istarts_with(content_type, "multipart/form-data") ) return false;
+
+    size_t pos = content_type.find("boundary=");
+    if ( pos == string::npos ) return false;
+
+    boundary = content_type.substr(pos + 9);
+    boundary = boundary.substr(0, boundary.find(';'));
+    boost::trim_if(boundary, boost::is_any_of(" \t\""));
+
+    return !boundary.empty();
+}
+
 int RequestParser::on_headers_complete(http_parser * parser){
     RequestParser &rp = *static_cast<RequestParser*>(parser->data);
     if ( !rp.current_header_value_.empty() ) {
-        rp.headers_[rp.current_header_field_] = rp.current_header_value_;
+        rp.headers_.replace(rp.current_header_field_, rp.current_header_value_);
         rp.current_header_field_.clear();
         rp.current_header_value_.clear();
     }
@@ -104,407 +122,272 @@ int RequestParser::on_headers_complete(http_parser * parser){
     // can process the Request (or response).  This is to properly
     // handle HTTP/1.1 pipelined Requests.
     http_parser_pause(parser, 1);
-    ostringstream strm;
-    strm << "HTTP/" << parser->http_major << "." << parser->http_minor;
-    rp.protocol_ = strm.str();
+    rp.headers_complete_ = true;
+    rp.protocol_ = "HTTP/" + std::to_string(parser->http_major) + '.' + std::to_string(parser->http_minor);
+
+    // reject large bodies before receiving them, the size of chunked bodies is checked in on_body
+    if ( rp.max_body_size_ && parser->content_length != ULLONG_MAX && parser->content_length > rp.max_body_size_ )
+        rp.body_too_large_ = true;
+
+    if ( parser->method == HTTP_POST ) {
+        auto it = rp.headers_.find("Content-Type");
+        string boundary;
+        if ( it != rp.headers_.end() && multipart_boundary(it->second, boundary) )
+            rp.multipart_.reset(new MultipartParser(boundary, rp.upload_spool_size_, rp.upload_dir_));
+    }
 
     return 0;
 }
 
 int RequestParser::on_url(http_parser *parser, const char *data, size_t size){
     RequestParser& rp = *static_cast<RequestParser*>(parser->data);
-    rp.url_.assign(data, size);
+    rp.url_.append(data, size);
 
     return 0;
 }
 
 int RequestParser::on_body(http_parser * parser, const char *data, size_t size){
-    static_cast<RequestParser*>(parser->data)->body_.append(data, size);
+    RequestParser &rp = *static_cast<RequestParser*>(parser->data);
+
+    rp.body_size_ += size;
+    if ( rp.max_body_size_ && rp.body_size_ > rp.max_body_size_ ) {
+        rp.body_too_large_ = true;
+        return 1;
+    }
+
+    if ( rp.multipart_ )
+        return rp.multipart_->feed(data, size) ? 0 : 1;
+
+    rp.body_.append(data, size);
     return 0;
 }
 
 boost::tribool RequestParser::parse(const char *data, size_t size){
-    std::size_t used = http_parser_execute(&parser_, &settings_, data, size);
-    const http_errno error = static_cast< http_errno >(parser_.http_errno);
-
-  // The 'on_message_complete' and 'on_headers_complete' callbacks fail
-  // on purpose to force the parser to stop between pipelined Requests.
-  // This allows the clients to reliably detect the end of headers and
-  // the end of the message.  Make sure the parser is always unpaused
-  // for the next call to 'feed'.
-    if (error == HPE_PAUSED) {
-        http_parser_pause(&parser_, 0);
-    }
+    size_t consumed;
+    return parse(data, size, consumed);
+}
 
-    if (used < size) {
-        if (error == HPE_PAUSED) {
-            // Make sure the byte that triggered the pause
-            // after the headers is properly processed.
-            if ( !is_complete_ )
-                used += http_parser_execute(&parser_, &settings_, data + used, size - used);
-        } else {
-            return false;
-        }
-    }
+boost::tribool RequestParser::parse(const char *data, size_t size, size_t &consumed){
+    consumed = 0;
 
-    return ( is_complete_ ? boost::tribool(true) : boost::indeterminate );
-}
+    while ( consumed < size && !is_complete_ ) {
+        std::size_t used = http_parser_execute(&parser_, &settings_, data + consumed, size - consumed);
+        const http_errno error = static_cast< http_errno >(parser_.http_errno);
 
-static int hex_decode(char c){
-    char ch = tolower(c);
+        consumed += used;
 
-    if ( ch >= 'a' && ch <= 'f' ) return 10 + ch - 'a';
-    else if ( ch >= '0' && ch <= '9' ) return ch - '0';
-    else return 0;
-}
+        // The 'on_message_complete' and 'on_headers_complete' callbacks pause
+        // on purpose to force the parser to stop between pipelined Requests.
+        // This allows the clients to reliably detect the end of headers and
+        // the end of the message.  Make sure the parser is always unpaused
+        // for the next call to 'feed'.
+        if ( error == HPE_PAUSED )
+            http_parser_pause(&parser_, 0);
+        else if ( error != HPE_OK )
+            return false;
 
-std::string url_decode(const char *str){
-    const char *p = str;
-    std::string ret;
-    while ( *p ) {
-        if( *p == '+' ) ret += ' ';
-        else if ( *p == '%' ) {
-            ++p;
-            char tmp[4];
-            unsigned char val = 16 * ( hex_decode(*p++) ) ;
-            val += hex_decode(*p);
-            sprintf(tmp,"%c", val);
-            ret += tmp;
-        } else ret += *p;
-        ++p;
+        if ( body_too_large_ ) return false;
     }
 
-    return ret;
+    return ( is_complete_ ? boost::tribool(true) : boost::indeterminate );
 }
 
-static bool has_url_field( http_parser_url &url, http_parser_url_fields field ){
-    return ((url.field_set & (1 << int(field))) != 0);
+bool RequestParser::keepAlive() const {
+    return http_should_keep_alive(&parser_) != 0;
 }
 
-static std::string get_url_field ( const string &data, http_parser_url &url, http_parser_url_fields field ) {
-    if ( !has_url_field(url, field) ) return string();
-    return ( data.substr(url.field_data[int(field)].off, url.field_data[int(field)].len) );
+static int hex_decode(char c){
+    if ( c >= 'a' && c <= 'f' ) return 10 + c - 'a';
+    else if ( c >= 'A' && c <= 'F' ) return 10 + c - 'A';
+    else if ( c >= '0' && c <= '9' ) return c - '0';
+    else return -1;
 }
 
-// fix invalid paths
-static string normalize_path( const string &src ) {
-    if ( src.empty() ) return "/";
-
-    std::vector<std::string> src_segments, dst_segments;
-    boost::split(src_segments, src, [](char ch) {
-         return ch == '/';
-    });
-
-    for( const string &seg: src_segments ) {
-        if ( seg.empty() ) continue;
-        else if ( seg == "." ) continue;
-        else if ( seg == "..") {
-            if ( !dst_segments.empty() )
-                dst_segments.pop_back();
+// decode the percent-encoded string [p, end) and append it to out
+static void url_decode(const char *p, const char *end, std::string &out){
+    out.reserve(out.size() + (end - p));
+
+    while ( p < end ) {
+        // copy runs of plain characters at once
+        const char *q = p;
+        while ( q < end && *q != '%' && *q != '+' ) ++q;
+        out.append(p, q);
+
+        if ( q == end ) break;
+
+        int hi, lo;
+        if ( *q == '+' ) {
+            out += ' ';
+            p = q + 1;
+        } else if ( end - q >= 3 && ( hi = hex_decode(q[1]) ) >= 0 && ( lo = hex_decode(q[2]) ) >= 0 ) {
+            out += static_cast<char>(hi * 16 + lo);
+            p = q + 3;
         } else {
-            dst_segments.push_back(seg);
+            out += '%';
+            p = q + 1;
         }
     }
-
-    if ( dst_segments.empty() ) return "/";
-    string res = "/" + boost::join(dst_segments, "/");
-    return res;
 }
 
-static bool parse_url(Request &req, const string url){
-    http_parser_url u;
-
-    int result = http_parser_parse_url(url.c_str(), url.length(), 0, &u);
-
-    if ( result ) return false;
-
-    string uri = get_url_field(url, u, UF_PATH);
-    string query = get_url_field(url, u, UF_QUERY);
-
-    req.path_ = normalize_path(url_decode(uri.c_str()));
-    req.query_ = url_decode(query.c_str());
-
-    if ( !req.query_.empty() ) {
-        std::vector<std::string> args;
+static void get_url_field(const string &data, http_parser_url &url, http_parser_url_fields field, const char *&p, const char *&end) {
+    p = end = data.data();
+    if ( ( url.field_set & (1 << int(field)) ) == 0 ) return;
 
-        boost::split(args, req.query_, boost::is_any_of("&"), boost::algorithm::token_compress_on);
-
-        for(int i=0; i<args.size(); i++ ) {
-            std::string &arg = args[i];
-
-            int pos = arg.find('=');
-            if ( pos > 0 ) {
-                std::string key = arg.substr((int)0, (int)pos);
-                std::string val = arg.substr((int)pos+1, -1);
-
-                req.GET_[key] = ( val.empty() ) ? "" : val;
-            }
-            else if ( pos == -1 )
-                req.GET_[arg] = "";
-        }
-    }
-
-    return true;
+    p += url.field_data[int(field)].off;
+    end = p + url.field_data[int(field)].len;
 }
 
-static bool parse_cookie(Request &session, const std::string &data){
-    int pos = data.find("=");
-
-    if ( pos == -1 ) return false;
+// fix invalid paths by removing empty, . and .. segments
+static string normalize_path( const string &src ) {
+    string res;
+    res.reserve(src.size() + 1);
 
-    boost::regex rx("[ \n\r\t\f\v]*");
-    boost::smatch rm;
+    const char *p = src.data(), *end = p + src.size();
 
-    boost::regex_search(data, rm, rx);
-    int wscount = rm[0].length();
+    while ( p < end ) {
+        const char *q = static_cast<const char *>(memchr(p, '/', end - p));
+        if ( !q ) q = end;
 
-    std::string name = data.substr(wscount, pos - wscount);
-    std::string value = data.substr(++pos);
+        size_t n = q - p;
+        if ( n == 0 || ( n == 1 && p[0] == '.' ) ) ;
+        else if ( n == 2 && p[0] == '.' && p[1] == '.' ) {
+            size_t pos = res.rfind('/');
+            res.resize( pos == string::npos ? 0 : pos );
+        } else {
+            res += '/';
+            res.append(p, n);
+        }
 
-    session.COOKIE_[name] = value;
+        if ( q == end ) break;
+        p = q + 1;
+    }
 
-    return true;
+    if ( res.empty() ) res = "/";
+    return res;
 }
 
-static bool parse_cookies(Request &session){
-    const char *ck = "Cookie";
-
-    if ( session.SERVER_.count(ck) == 0 ) return true;
+// parse name=value pairs separated by & in [p, end). Names without a value are stored with an empty value if
+// allow_no_value is set, otherwise they make parsing fail.
+static bool parse_urlencoded(const char *p, const char *end, Dictionary &vars, bool allow_no_value) {
+    while ( p < end ) {
+        const char *q = static_cast<const char *>(memchr(p, '&', end - p));
+        if ( !q ) q = end;
 
-    std::string data = session.SERVER_[ck];
+        if ( q > p ) {
+            const char *eq = static_cast<const char *>(memchr(p, '=', q - p));
 
-    if ( data.empty() ) return false;
-
-    int  old_pos = 0;
-
-    while (1) {
-        // find the ';' terminating a name=value pair
-        int pos = data.find(";", old_pos);
+            if ( !eq && !allow_no_value ) return false;
 
-        // if no ';' was found, the rest of the string is a single cookie
+            if ( eq != p ) {
+                string key;
+                url_decode(p, eq ? eq : q, key);
 
-        if ( pos == -1 ) {
-            bool res = parse_cookie(session, data.substr(old_pos, (int)-1));
-            return res;
+                string &val = vars[std::move(key)];
+                val.clear();
+                if ( eq ) url_decode(eq + 1, q, val);
+            }
         }
 
-        // otherwise, the string contains multiple cookies
-        // extract it and add the cookie to the list
-        if ( !parse_cookie(session, data.substr(old_pos, pos - old_pos)) ) return false;
-
-        // update pos (+1 to skip ';')
-        old_pos = pos + 1;
+        if ( q == end ) break;
+        p = q + 1;
     }
 
     return true;
 }
 
-static std::string get_next_line(std::istream &strm, int maxc = 1000){
-    std::string res;
-    char b0, b1;
-    int count = 0;
-
-    while ( count < maxc && !strm.eof() ) {
-        b0 = strm.get();
-        count ++;
-
-        if ( b0 == '\r' )
-        {
-            b1 = strm.get();
-            count ++;
-
-            if ( b1 == '\n' ) return res;
-            else {
-                res += b0;
-                res += b1;
-            }
-        }
-        else res += b0;
-    }
-
-    return res;
-}
+static bool parse_url(Request &req, const string &url){
+    http_parser_url u;
 
-namespace fs = boost::filesystem;
-fs::path get_temporary_path(const std::string &dir, const std::string &prefix, const std::string &ext){
-    std::string retVal;
+    int result = http_parser_parse_url(url.c_str(), url.length(), 0, &u);
 
-    fs::path directory;
+    if ( result ) return false;
 
-    if ( ! dir.empty() ) directory = dir;
-    else directory = boost::filesystem::temp_directory_path();
+    const char *path, *path_end, *query, *query_end;
+    get_url_field(url, u, UF_PATH, path, path_end);
+    get_url_field(url, u, UF_QUERY, query, query_end);
 
-    std::string varname ="%%%%-%%%%-%%%%-%%%%";
+    string decoded_path;
+    url_decode(path, path_end, decoded_path);
+    req.path_ = normalize_path(decoded_path);
 
-    if ( !prefix.empty() )
-        directory /= prefix + '-' + varname + '.' + ext;
-    else
-        directory /= "tmp-" + varname + '.' + ext;
+    req.query_.clear();
+    url_decode(query, query_end, req.query_);
 
-    boost::filesystem::path temp = boost::filesystem::unique_path(directory);
+    // names and values are decoded separately so that they may contain encoded & and =
+    parse_urlencoded(query, query_end, req.GET_, true);
 
-    return temp;
+    return true;
 }
 
-static bool parse_mime_data(Request &session, istream &strm, const string &fld, const string &file_name,
-                          const string &content_type,
-                          const string trans_encoding,
-                          const string &bnd){
-    std::string data;
-    char b[4] = {0};
-
-    while ( strm ) {
-        char c = strm.get();
-        b[0] = b[1]; b[1] = b[2]; b[2] = b[3]; b[3] = c;
-
-        if ( b[0] == '\r' && b[1] == '\n' && b[2] == '-' && b[3] == '-') {
-            data.resize(data.size() - 3);
-            int bndlen = bnd.length();
-            string buf;
-            buf.resize(bndlen);
-
-            strm.read(&buf[0], bndlen);
-
-            if ( buf == bnd ) {
-                strm.get(); strm.get();
-                break;
-            }
-        }
-        else data.push_back(c);
-    }
-
-    if ( file_name.empty() ) session.POST_[fld] = data;
-    else
-    {
-        static const size_t file_upload_max_size = 20 * 1024 * 1024;
-        static const size_t file_upload_persist_file_size = 1 * 1024 * 1024;
+// parse the Cookie header i.e. name=value pairs separated by ;
+static bool parse_cookies(Request &session){
+    auto it = session.SERVER_.find("Cookie");
 
-        size_t dsize = data.size();
+    if ( it == session.SERVER_.end() ) return true;
 
-        if ( dsize <= file_upload_max_size ) {
-            Request::UploadedFile file_info;
+    const std::string &data = it->second;
 
-            file_info.mime_ = content_type;
-            file_info.name_ = file_name;
-            file_info.data_ = data;
+    if ( data.empty() ) return false;
 
-/*
-            if ( dsize > file_upload_persist_file_size ) {
-                boost::filesystem::path server_path = get_temporary_path(string(), "up", "tmp");
+    const char *p = data.data(), *end = p + data.size();
 
-                ofstream strm(server_path.string(), ios::binary);
-                strm.write(&data[0], data.size());
+    while ( p < end ) {
+        const char *q = static_cast<const char *>(memchr(p, ';', end - p));
+        if ( !q ) q = end;
 
-                file_info.path_ = server_path.string();
-            } else {
-            */
+        // skip leading white space of the name
+        while ( p < q && isspace(static_cast<unsigned char>(*p)) ) ++p;
 
-            /*}*/
+        if ( p < q ) {
+            const char *eq = static_cast<const char *>(memchr(p, '=', q - p));
+            if ( !eq ) return false;
 
-            file_info.size_ = data.size();
-            session.FILE_.insert({fld, file_info});
+            session.COOKIE_[string(p, eq)].assign(eq + 1, q);
         }
-    }
 
-    return true;
-}
-
-static bool parse_multipart_data(Request &session, istream &strm, const string &bnd){
-    std::string s = get_next_line(strm);
-    if ( s.empty() ) return false;
-    if ( s.compare(2, bnd.length(), bnd ) != 0 ) return false;
-    while ( 1 ) {
-        std::string form_field, file_name, content_type, trans_encoding;
-        while ( 1 ) {
-            s = get_next_line(strm);
-            if ( s.empty() ) break;
-
-            size_t pos = s.find(':');
-            if ( pos != string::npos ) {
-                std::string key, val;
-                key.assign(s, 0, pos);
-                boost::trim(key);
-                val.assign(s, pos+1, s.length() - pos);
-                boost::trim(val);
-
-                boost::smatch subm;
-                if ( key == "Content-Disposition" ) {
-                    if ( boost::regex_match(val, subm, boost::regex(R"#(form-data;\s*name="(.*?)(?=")"(?:\s*;\s*filename="(.*?)(?=")")?)#") ) ) {
-                        form_field = subm[1];
-                        file_name = subm[2];
-                    }
-                }
-                else if ( key.compare(0, 12, "Content-Type") == 0 )
-                    content_type = val;
-                else if ( key.compare(0, 25, "Content-Transfer-Encoding") == 0 )
-                    trans_encoding = val;
-            }
-        }
-
-        if ( form_field.empty() ) break;
-
-        // Parse content
-        if ( ! parse_mime_data(session, strm, form_field, file_name, content_type, trans_encoding, bnd) ) return false;
+        if ( q == end ) break;
+        p = q + 1;
     }
 
     return true;
 }
 
-static bool parse_form_data(Request &session, istream &strm){
-    size_t content_length = session.SERVER_.value<int>("Content-Length", 0);
-    std::string content_type = session.SERVER_.get("Content-Type");
+static bool parse_form_data(Request &session){
+    const std::string content_type = session.SERVER_.get("Content-Type");
 
-    if ( content_type.empty() && content_length > 0 )
+    if ( content_type.empty() && !session.content_.empty() )
         return false;
 
-    boost::smatch subm;
-    if ( boost::starts_with(content_type, "application/x-www-form-urlencoded") )
-    {
-        // parse name value pairs
-        std::string s = get_next_line(strm, content_length);
-        typedef boost::tokenizer<boost::char_separator<char>>   tokenizer;
-        boost::char_separator<char> sep("&");
-        tokenizer tokens(s, sep);
-
-        for (tokenizer::iterator it = tokens.begin(); it != tokens.end(); ++it) {
-            std::string str = (*it);
-
-            size_t pos = str.find('=');
-            if ( pos == string::npos ) return false;
-
-            std::string key, val;
-            key = str.substr(0, pos);
-            val = str.substr(pos+1);
-            session.POST_[url_decode(key.c_str())] = url_decode(val.c_str());
-        }
-    } else if ( boost::regex_match(content_type, subm, boost::regex("multipart/form-data;\\s*boundary=(.*)")  )) {
-        std::string boundary = subm[1];
-        parse_multipart_data(session, strm, boundary);
-    } else if ( content_length )  {
-        session.content_.resize(content_length);
-        strm.read(&session.content_[0], content_length);
+    if ( boost::starts_with(content_type, "application/x-www-form-urlencoded") ) {
+        // name value pairs on the first line of the body
+        const char *p = session.content_.data(), *end = p + session.content_.size();
+        const char *eol = std::search(p, end, "\r\n", "\r\n" + 2);
+
+        return parse_urlencoded(p, eol, session.POST_, false);
+    } else if ( !session.content_.empty() )  {
         session.content_type_ = content_type;
     }
 
     return true;
 }
 
-
-bool RequestParser::decode_message(Request &req) const {
-    for( auto hdr: headers_ )
-        req.SERVER_.add(hdr.first, hdr.second);
+bool RequestParser::decode_message(Request &req) {
+    // the parser gets the storage of the previous request (cleared by Request::clear) for the next message
+    req.SERVER_.swap(headers_);
+    req.content_.swap(body_);
 
     req.method_ = req.SERVER_["REQUEST_METHOD"] =	http_method_str(static_cast<http_method>(parser_.method));
     req.protocol_ = protocol_;
-    req.content_ = body_;
 
     if ( !parse_url(req, url_) ||
         !parse_cookies(req) ) return false;
 
-    if ( req.method_ == "POST" ) {
-        stringstream reqstr(body_);
-
-        if ( !parse_form_data(req, reqstr) ) return false;
+    if ( multipart_ ) {
+        if ( !multipart_->isComplete() ) return false;
+        multipart_->decode(req);
+    }
+    else if ( req.method_ == "POST" ) {
+        if ( !parse_form_data(req) ) return false;
     }
 
     return true;
@@ -9,16 +9,20 @@
 //
 
 #include <wspp/server/response.hpp>
+#include <wspp/server/request.hpp>
 #include <wspp/util/zstream.hpp>
 #include <wspp/util/filesystem.hpp>
 #include <wspp/server/exceptions.hpp>
+#include <wspp/server/detail/file_body.hpp>
+#include <wspp/server/detail/http_date.hpp>
 
-#include <boost/lexical_cast.hpp>
 #include <boost/filesystem.hpp>
 #include <boost/asio.hpp>
 #include <boost/date_time.hpp>
 #include <boost/regex.hpp>
 
+#include <algorithm>
+#include <atomic>
 #include <fstream>
 #include <iostream>
 #include <map>
@@ -33,103 +37,162 @@ namespace wspp {
 namespace server {
 namespace status_strings {
 const std::string ok =
-        "HTTP/1.0 200 OK\r\n";
+        "HTTP/1.1 200 OK\r\n";
 const std::string created =
-        "HTTP/1.0 201 Created\r\n";
+        "HTTP/1.1 201 Created\r\n";
 const std::string accepted =
-        "HTTP/1.0 202 Accepted\r\n";
+        "HTTP/1.1 202 Accepted\r\n";
 const std::string no_content =
-        "HTTP/1.0 204 No Content\r\n";
+        "HTTP/1.1 204 No Content\r\n";
+const std::string partial_content =
+        "HTTP/1.1 206 Partial Content\r\n";
 const std::string multiple_choices =
-        "HTTP/1.0 300 Multiple Choices\r\n";
+        "HTTP/1.1 300 Multiple Choices\r\n";
 const std::string moved_permanently =
-        "HTTP/1.0 301 Moved Permanently\r\n";
+        "HTTP/1.1 301 Moved Permanently\r\n";
 const std::string moved_temporarily =
-        "HTTP/1.0 302 Moved Temporarily\r\n";
+        "HTTP/1.1 302 Moved Temporarily\r\n";
 const std::string not_modified =
-        "HTTP/1.0 304 Not Modified\r\n";
+        "HTTP/1.1 304 Not Modified\r\n";
 const std::string bad_request =
-        "HTTP/1.0 400 Bad Request\r\n";
+        "HTTP/1.1 400 Bad Request\r\n";
 const std::string unauthorized =
-        "HTTP/1.0 401 Unauthorized\r\n";
+        "HTTP/1.1 401 Unauthorized\r\n";
 const std::string forbidden =
-        "HTTP/1.0 403 Forbidden\r\n";
+        "HTTP/1.1 403 Forbidden\r\n";
 const std::string not_found =
-        "HTTP/1.0 404 Not Found\r\n";
+        "HTTP/1.1 404 Not Found\r\n";
+const std::string payload_too_large =
+        "HTTP/1.1 413 Payload Too Large\r\n";
+const std::string range_not_satisfiable =
+        "HTTP/1.1 416 Range Not Satisfiable\r\n";
 const std::string internal_server_error =
-        "HTTP/1.0 500 Internal Server Error\r\n";
+        "HTTP/1.1 500 Internal Server Error\r\n";
 const std::string not_implemented =
-        "HTTP/1.0 501 Not Implemented\r\n";
+        "HTTP/1.1 501 Not Implemented\r\n";
 const std::string bad_gateway =
-        "HTTP/1.0 502 Bad Gateway\r\n";
+        "HTTP/1.1 502 Bad Gateway\r\n";
 const std::string service_unavailable =
-        "HTTP/1.0 503 Service Unavailable\r\n";
+        "HTTP/1.1 503 Service Unavailable\r\n";
 
-boost::asio::const_buffer to_buffer(Response::Status status){
+const std::string &to_string(Response::Status status){
     switch (status) {
     case Response::ok:
-        return boost::asio::buffer(ok);
+        return ok;
     case Response::created:
-        return boost::asio::buffer(created);
+        return created;
     case Response::accepted:
-        return boost::asio::buffer(accepted);
+        return accepted;
     case Response::no_content:
-        return boost::asio::buffer(no_content);
+        return no_content;
+    case Response::partial_content:
+        return partial_content;
     case Response::multiple_choices:
-        return boost::asio::buffer(multiple_choices);
+        return multiple_choices;
     case Response::moved_permanently:
-        return boost::asio::buffer(moved_permanently);
+        return moved_permanently;
     case Response::moved_temporarily:
-        return boost::asio::buffer(moved_temporarily);
+        return moved_temporarily;
     case Response::not_modified:
-        return boost::asio::buffer(not_modified);
+        return not_modified;
     case Response::bad_request:
-        return boost::asio::buffer(bad_request);
+        return bad_request;
     case Response::unauthorized:
-        return boost::asio::buffer(unauthorized);
+        return unauthorized;
     case Response::forbidden:
-        return boost::asio::buffer(forbidden);
+        return forbidden;
     case Response::not_found:
-        return boost::asio::buffer(not_found);
+        return not_found;
+    case Response::payload_too_large:
+        return payload_too_large;
+    case Response::range_not_satisfiable:
+        return range_not_satisfiable;
     case Response::internal_server_error:
-        return boost::asio::buffer(internal_server_error);
+        return internal_server_error;
     case Response::not_implemented:
-        return boost::asio::buffer(not_implemented);
+        return not_implemented;
     case Response::bad_gateway:
-        return boost::asio::buffer(bad_gateway);
+        return bad_gateway;
     case Response::service_unavailable:
-        return boost::asio::buffer(service_unavailable);
+        return service_unavailable;
     default:
-        return boost::asio::buffer(internal_server_error);
+        return internal_server_error;
     }
 }
 } // namespace status_strings
 
-namespace misc_strings {
-const char name_value_separator[] = { ':', ' ' };
-const char crlf[] = { '\r', '\n' };
-} // namespace misc_strings
+// Write the decimal digits of n at the end of buf
+static void append_uint(std::string &buf, uint64_t n) {
+    char digits[20];
+    char *p = digits + sizeof(digits);
+    do {
+        *--p = '0' + n % 10;
+        n /= 10;
+    } while ( n );
+    buf.append(p, digits + sizeof(digits) - p);
+}
 
-// Convert the reply into a vector of buffers. The buffers do not own the
-// underlying memory blocks, therefore the reply object must remain valid and
-// not be changed until the write operation has completed.
-std::vector<boost::asio::const_buffer> response_to_buffers(Response &rep, bool is_head){
-    std::vector<boost::asio::const_buffer> buffers;
-    buffers.push_back(status_strings::to_buffer(rep.status_));
+// Convert the reply into a vector of buffers. The status line and headers are written to the headers buffer,
+// so that a reply with its body in memory is sent as two buffers. The Date header and, unless set by the
+// handler, the Content-Length header are added here. The buffers do not own the underlying memory blocks,
+// therefore the reply object must remain valid and not be changed until the write operation has completed.
+// The buffers are cleared first so that the caller may reuse their memory for consecutive replies.
+void response_to_buffers(Response &rep, bool is_head, std::string &headers, std::vector<boost::asio::const_buffer> &buffers){
+    const std::string &status_line = status_strings::to_string(rep.status_);
+    bool has_length = rep.generator_ || rep.status_ == Response::not_modified || rep.status_ == Response::no_content ||
+            rep.headers_.contains("Content-Length");
+
+    std::size_t size = status_line.size() + detail::HttpDate::size + 10;
+    for( const auto &h: rep.headers_ )
+        size += h.first.size() + h.second.size() + 4;
+    if ( !has_length ) size += 40;
+
+    headers.clear();
+    headers.reserve(size);
+    headers.append(status_line);
 
     for( const auto &h: rep.headers_ ) {
-        buffers.push_back(boost::asio::buffer(h.first));
-        buffers.push_back(boost::asio::buffer(misc_strings::name_value_separator));
-        buffers.push_back(boost::asio::buffer(h.second));
-        buffers.push_back(boost::asio::buffer(misc_strings::crlf));
+        headers.append(h.first);
+        headers.append(": ", 2);
+        headers.append(h.second);
+        headers.append("\r\n", 2);
     }
 
-    if ( !is_head ) {
-        buffers.push_back(boost::asio::buffer(misc_strings::crlf));
-        buffers.push_back(boost::asio::buffer(rep.content_));
+    if ( !rep.headers_.contains("Date") )
+        detail::HttpDate::appendHeader(headers);
+
+    if ( !has_length ) {
+        headers.append("Content-Length: ", 16);
+        append_uint(headers, rep.contentLength());
+        headers.append("\r\n", 2);
     }
 
-    return buffers;
+    headers.append("\r\n", 2);
+
+    buffers.clear();
+    buffers.push_back(boost::asio::buffer(headers));
+
+    if ( is_head ) return;
+
+    // streamed bodies are sent by the connection as they are generated
+    if ( rep.generator_ ) return;
+
+    if ( rep.file_ ) {
+        // files read in memory are sent along with the headers, otherwise the connection streams the file
+        if ( !rep.file_->data() ) return;
+
+        if ( rep.ranges_.empty() )
+            buffers.push_back(boost::asio::buffer(rep.file_->data(), rep.file_->size()));
+        else {
+            for( const auto &r: rep.ranges_ ) {
+                if ( !r.prefix_.empty() ) buffers.push_back(boost::asio::buffer(r.prefix_));
+                buffers.push_back(boost::asio::buffer(rep.file_->data() + r.offset_, r.length_));
+            }
+            if ( !rep.ranges_suffix_.empty() ) buffers.push_back(boost::asio::buffer(rep.ranges_suffix_));
+        }
+    }
+    else if ( !rep.content_.empty() )
+        buffers.push_back(boost::asio::buffer(rep.content_));
 }
 
 namespace stock_replies {
@@ -149,6 +212,7 @@ const char no_content[] =
         "<head><title>No Content</title></head>"
         "<body><h1>204 Content</h1></body>"
         "</html>";
+const char partial_content[] = "";
 const char multiple_choices[] =
         "<html>"
         "<head><title>Multiple Choices</title></head>"
@@ -189,6 +253,16 @@ const char not_found[] =
         "<head><title>Not Found</title></head>"
         "<body><h1>404 Not Found</h1></body>"
         "</html>";
+const char payload_too_large[] =
+        "<html>"
+        "<head><title>Payload Too Large</title></head>"
+        "<body><h1>413 Payload Too Large</h1></body>"
+        "</html>";
+const char range_not_satisfiable[] =
+        "<html>"
+        "<head><title>Range Not Satisfiable</title></head>"
+        "<body><h1>416 Range Not Satisfiable</h1></body>"
+        "</html>";
 const char internal_server_error[] =
         "<html>"
         "<head><title>Internal Server Error</title></head>"
@@ -221,6 +295,8 @@ std::string to_string(Response::Status status){
         return accepted;
     case Response::no_content:
         return no_content;
+    case Response::partial_content:
+        return partial_content;
     case Response::multiple_choices:
         return multiple_choices;
     case Response::moved_permanently:
@@ -237,6 +313,10 @@ std::string to_string(Response::Status status){
         return forbidden;
     case Response::not_found:
         return not_found;
+    case Response::payload_too_large:
+        return payload_too_large;
+    case Response::range_not_satisfiable:
+        return range_not_satisfiable;
     case Response::internal_server_error:
         return internal_server_error;
     case Response::not_implemented:
@@ -251,47 +331,93 @@ std::string to_string(Response::Status status){
 }
 } // namespace stock_replies
 
+boost::asio::const_buffer overload_response() {
+    static const std::string response = [] {
+        std::string body(stock_replies::service_unavailable);
+        return status_strings::service_unavailable +
+                "Content-Type: text/html\r\n"
+                "Content-Length: " + std::to_string(body.size()) + "\r\n"
+                "Retry-After: 1\r\n"
+                "Connection: close\r\n"
+                "\r\n" + body;
+    }();
+
+    return boost::asio::buffer(response);
+}
+
 void Response::stockReply(Response::Status status){
     status_ = status;
+    file_.reset();
+    generator_ = nullptr;
+
+    // these replies never have a body
+    if ( status == not_modified || status == no_content ) {
+        content_.clear();
+        headers_.remove("Content-Length");
+        return;
+    }
+
     content_.assign(stock_replies::to_string(status));
     setContentType("text/html");
     setContentLength();
 }
 
-static void gmt_time_string(char *buf, size_t buf_len, time_t *t) {
-    strftime(buf, buf_len, "%a, %d %b %Y %H:%M:%S GMT", gmtime(t));
+void Response::clear() {
+    status_ = not_found;
+    ranges_.clear();
+    ranges_suffix_.clear();
+    headers_.clear();
+    content_.clear();
+    file_.reset();
+    generator_ = nullptr;
 }
 
-void Response::encodeFileData(const std::string &bytes, const std::string &encoding, const std::string &mime, time_t mod_time){
+void Response::encodeFileHeaders(uint64_t size, const std::string &encoding, const std::string &mime, time_t mod_time,
+                                 const std::string &etag){
     status_ = ok;
 
-    if ( bytes.empty() ) return;
-
-    // try gzip encoding
-    if ( encoding.empty() ) {
-        if ( bytes.size() > 2 && bytes[0] == 0x1f && bytes[1] == 0x8b )
-            headers_.add("Content-Encoding", "gzip");
-    }
-    else
+    if ( !encoding.empty() )
         headers_.add("Content-Encoding", encoding);
 
     if ( !mime.empty() )
         headers_.add("Content-Type", mime);
 
     headers_.add("Access-Control-Allow-Origin", "*");
+    headers_.add("Accept-Ranges", "bytes");
 
-    char ctime_buf[64], mtime_buf[64];
-    time_t curtime = time(nullptr);
+    // the Date header is added when the reply is sent
+    if ( mod_time ) {
+        char mtime_buf[detail::HttpDate::size + 1];
+        detail::HttpDate::format(mod_time, mtime_buf);
+        headers_.add("Last-Modified", mtime_buf);
+    }
 
-    gmt_time_string(ctime_buf, sizeof(ctime_buf), &curtime);
-    gmt_time_string(mtime_buf, sizeof(mtime_buf), &mod_time);
+    headers_.add("ETag", etag);
+    headers_.add("Content-Length", std::to_string(size));
+}
 
-    headers_.add("Date", ctime_buf);
-    headers_.add("Last-Modified", mtime_buf);
+// gzip if the data starts with the gzip signature. Other codings are not guessed since clients that do not accept
+// them could not decode the reply, files compressed with them are served as they are unless the encoding is given.
+static const char *data_encoding(const char *bytes, size_t size) {
+    const unsigned char *b = reinterpret_cast<const unsigned char *>(bytes);
+    if ( size > 2 && b[0] == 0x1f && b[1] == 0x8b ) return "gzip";
+    return "";
+}
 
-    headers_.add("Etag", boost::lexical_cast<std::string>(mod_time));
-    headers_.add("Content-Length", boost::lexical_cast<std::string>(bytes.size()));
+void Response::encodeFileData(const std::string &bytes, const std::string &encoding, const std::string &mime, time_t mod_time){
+    status_ = ok;
 
+    if ( bytes.empty() ) return;
+
+    // try gzip encoding
+    string oencoding = encoding;
+    if ( oencoding.empty() )
+        oencoding = data_encoding(bytes.data(), bytes.size());
+
+    encodeFileHeaders(bytes.size(), oencoding, mime, mod_time, entityTag(bytes));
+
+    file_.reset();
+    generator_ = nullptr;
     content_.assign(bytes);
 }
 
@@ -309,7 +435,8 @@ static string get_file_mime(const string &mime,  const boost::filesystem::path &
 
     string extension = p.extension().string();
 
-    if ( extension == ".gz" )
+    // precompressed copies of files (see ContentEncoding::extension)
+    if ( extension == ".gz" || extension == ".br" || extension == ".zst" )
         extension = p.stem().extension().string();
 
     if ( !extension.empty() ) {
@@ -320,16 +447,275 @@ static string get_file_mime(const string &mime,  const boost::filesystem::path &
     return "application/octet-stream";
 }
 
+// strong entity tag of a file from its inode, size, modification time and encoding, so that the encodings of a file
+// kept in memory (see FileBody::fromMemory) have distinct tags
+static string file_entity_tag(const detail::FileBody &file, const string &encoding) {
+    char buf[96];
+    snprintf(buf, sizeof(buf), encoding.empty() ? "\"%llx-%llx-%llx\"" : "\"%llx-%llx-%llx-%s\"",
+             (unsigned long long)file.inode(), (unsigned long long)file.size(), (unsigned long long)file.mtime(),
+             encoding.c_str());
+    return buf;
+}
+
+string Response::fileMimeType(const string &path) {
+    return get_file_mime(string(), path);
+}
+
 void Response::encodeFile(const std::string &file_path, const std::string &encoding, const std::string &mime ){
-    if ( !fs::exists(file_path) ) {
+    std::shared_ptr<detail::FileBody> file = detail::FileBody::open(file_path);
+
+    if ( !file )
         throw HttpResponseException(Response::not_found);
-        return;
+
+    // try gzip encoding
+    string oencoding = encoding;
+    if ( oencoding.empty() ) {
+        string magic = file->read(0, 3);
+        oencoding = data_encoding(magic.data(), magic.size());
     }
 
-    time_t mod_time = boost::filesystem::last_write_time(file_path);
-    string bytes = readFileToString(file_path);
-    string omime = mime.empty() ? get_file_mime(mime, file_path) : mime;
-    encodeFileData(bytes, encoding, omime, mod_time);
+    encodeFile(file, oencoding, mime.empty() ? get_file_mime(mime, file_path) : mime);
+}
+
+void Response::encodeFile(const std::shared_ptr<detail::FileBody> &file, const string &encoding, const string &mime) {
+    encodeFileHeaders(file->size(), encoding, mime, file->mtime(), file_entity_tag(*file, encoding));
+
+    content_.clear();
+    generator_ = nullptr;
+    ranges_.clear();
+    file_ = file;
+}
+
+// FNV-1a hash of the content
+static uint64_t content_hash(const string &content) {
+    uint64_t h = 0xcbf29ce484222325ULL;
+    for( unsigned char c: content ) {
+        h ^= c;
+        h *= 0x100000001b3ULL;
+    }
+    return h;
+}
+
+string Response::entityTag(const string &content, bool weak) {
+    char buf[32];
+    snprintf(buf, sizeof(buf), "%s\"%016llx\"", weak ? "W/" : "", (unsigned long long)content_hash(content));
+    return buf;
+}
+
+// whether the entity tags are equal ignoring the weak prefix (the weak comparison of RFC 7232)
+static bool etag_matches(const char *a, size_t alen, const string &b) {
+    if ( alen > 2 && a[0] == 'W' && a[1] == '/' ) { a += 2; alen -= 2; }
+    size_t bpos = b.compare(0, 2, "W/") == 0 ? 2 : 0;
+    return alen == b.size() - bpos && b.compare(bpos, alen, a, alen) == 0;
+}
+
+// whether one of the comma separated entity tags of the If-None-Match header matches etag
+static bool if_none_match(const string &header, const string &etag) {
+    size_t pos = 0;
+    while ( pos < header.size() ) {
+        size_t end = header.find(',', pos);
+        if ( end == string::npos ) end = header.size();
+
+        size_t first = pos, last = end;
+        while ( first < last && isspace((unsigned char)header[first]) ) first++;
+        while ( last > first && isspace((unsigned char)header[last-1]) ) last--;
+
+        if ( last - first == 1 && header[first] == '*' ) return true;
+        if ( etag_matches(header.data() + first, last - first, etag) ) return true;
+
+        pos = end + 1;
+    }
+    return false;
+}
+
+bool Response::checkNotModified(const Request &req, const string &etag, time_t last_modified) {
+    if ( !etag.empty() ) headers_.replace("ETag", etag);
+
+    if ( last_modified ) {
+        char mtime_buf[detail::HttpDate::size + 1];
+        detail::HttpDate::format(last_modified, mtime_buf);
+        headers_.replace("Last-Modified", mtime_buf);
+    }
+
+    return notModified(req);
+}
+
+bool Response::notModified(const Request &req) {
+    if ( req.method_ != "GET" && req.method_ != "HEAD" ) return false;
+
+    bool not_modified = false;
+
+    // If-Modified-Since is ignored when If-None-Match is present
+    auto inm = req.SERVER_.find("If-None-Match");
+    if ( inm != req.SERVER_.end() ) {
+        auto etag = headers_.find("ETag");
+        not_modified = etag != headers_.end() && if_none_match(inm->second, etag->second);
+    }
+    else {
+        auto ims = req.SERVER_.find("If-Modified-Since");
+        auto lm = headers_.find("Last-Modified");
+        time_t since, modified;
+        not_modified = ims != req.SERVER_.end() && lm != headers_.end() &&
+                detail::HttpDate::parse(ims->second, since) && detail::HttpDate::parse(lm->second, modified) &&
+                modified <= since;
+    }
+
+    if ( not_modified ) stockReply(Response::not_modified);
+    return not_modified;
+}
+
+// most ranges accepted in a Range header, a header with more is ignored. Together with merging overlapping ranges (see
+// merge_ranges) this keeps the size of a multipart reply close to the size of the body.
+static const size_t max_ranges = 16;
+
+// Parse the byte ranges of a Range header ("bytes=0-99,200-,-50") of a body of the given size. Returns false if the
+// header is not valid (and should be ignored), unsatisfiable ranges are skipped.
+static bool parse_ranges(const string &header, uint64_t size, vector<pair<uint64_t, uint64_t>> &ranges) {
+    if ( header.compare(0, 6, "bytes=") != 0 ) return false;
+
+    size_t pos = 6, count = 0;
+    while ( pos <= header.size() ) {
+        size_t end = header.find(',', pos);
+        if ( end == string::npos ) end = header.size();
+
+        size_t first = pos, last = end;
+        while ( first < last && isspace((unsigned char)header[first]) ) first++;
+        while ( last > first && isspace((unsigned char)header[last-1]) ) last--;
+        pos = end + 1;
+
+        // empty elements of the list are allowed
+        if ( first == last ) continue;
+        if ( ++count > max_ranges ) return false;
+
+        size_t dash = header.find('-', first);
+        if ( dash == string::npos || dash >= last ) return false;
+
+        auto parse_number = [&] (size_t b, size_t e, uint64_t &n) {
+            if ( b == e || e - b > 19 ) return false;
+            n = 0;
+            for( size_t i = b ; i < e ; i++ ) {
+                if ( !isdigit((unsigned char)header[i]) ) return false;
+                n = n * 10 + (header[i] - '0');
+            }
+            return true;
+        };
+
+        uint64_t from, to;
+        if ( dash == first ) {
+            // the last bytes of the body
+            uint64_t suffix;
+            if ( !parse_number(dash + 1, last, suffix) ) return false;
+            if ( suffix == 0 || size == 0 ) continue;
+            from = suffix >= size ? 0 : size - suffix;
+            to = size - 1;
+        }
+        else {
+            if ( !parse_number(first, dash, from) ) return false;
+            if ( dash + 1 == last ) to = size - 1;
+            else if ( !parse_number(dash + 1, last, to) || to < from ) return false;
+            if ( from >= size ) continue;
+            to = std::min(to, size - 1);
+        }
+
+        ranges.emplace_back(from, to);
+    }
+
+    return count > 0;
+}
+
+// Sort the ranges and merge those that overlap or are adjacent, so that no byte of the body is sent twice
+static void merge_ranges(vector<pair<uint64_t, uint64_t>> &ranges) {
+    if ( ranges.size() < 2 ) return;
+
+    std::sort(ranges.begin(), ranges.end());
+
+    size_t n = 0;
+    for( size_t i = 1 ; i < ranges.size() ; i++ ) {
+        if ( ranges[i].first <= ranges[n].second + 1 )
+            ranges[n].second = std::max(ranges[n].second, ranges[i].second);
+        else
+            ranges[++n] = ranges[i];
+    }
+    ranges.resize(n + 1);
+}
+
+static string content_range(uint64_t from, uint64_t to, uint64_t size) {
+    char buf[80];
+    snprintf(buf, sizeof(buf), "bytes %llu-%llu/%llu", (unsigned long long)from, (unsigned long long)to,
+             (unsigned long long)size);
+    return buf;
+}
+
+// whether the If-Range header (an entity tag or a date) matches the validators of the reply
+static bool if_range_matches(const string &header, const HeaderMap &headers) {
+    if ( header.empty() ) return true;
+
+    // entity tags are compared strongly
+    if ( header[0] == '"' ) return header == headers.get("ETag");
+    if ( header.compare(0, 2, "W/") == 0 ) return false;
+
+    return header == headers.get("Last-Modified");
+}
+
+bool Response::sendRanges(const Request &req) {
+    if ( status_ != ok || req.method_ != "GET" || generator_ ) return false;
+
+    auto range = req.SERVER_.find("Range");
+    if ( range == req.SERVER_.end() ) return false;
+
+    if ( !if_range_matches(req.SERVER_.get("If-Range"), headers_) ) return false;
+
+    uint64_t size = file_ ? file_->size() : content_.size();
+
+    vector<pair<uint64_t, uint64_t>> ranges;
+    if ( !parse_ranges(range->second, size, ranges) ) return false;
+    merge_ranges(ranges);
+
+    if ( ranges.empty() ) {
+        stockReply(range_not_satisfiable);
+        headers_.replace("Content-Range", "bytes */" + std::to_string(size));
+        return true;
+    }
+
+    status_ = partial_content;
+    ranges_.clear();
+    ranges_suffix_.clear();
+
+    if ( ranges.size() == 1 ) {
+        uint64_t from = ranges[0].first, to = ranges[0].second;
+        headers_.replace("Content-Range", content_range(from, to, size));
+
+        if ( file_ ) ranges_.push_back(FileRange{from, to - from + 1, string()});
+        else content_ = content_.substr(from, to - from + 1);
+    }
+    else {
+        static std::atomic<uint64_t> counter(0);
+        char boundary[40];
+        snprintf(boundary, sizeof(boundary), "wspp%016llx", (unsigned long long)(counter++ ^ ((uint64_t)time(nullptr) << 24)));
+
+        string mime = headers_.get("Content-Type");
+        headers_.replace("Content-Type", string("multipart/byteranges; boundary=") + boundary);
+
+        string body;
+        for( const auto &r: ranges ) {
+            string prefix = string("\r\n--") + boundary + "\r\n";
+            if ( !mime.empty() ) prefix += "Content-Type: " + mime + "\r\n";
+            prefix += "Content-Range: " + content_range(r.first, r.second, size) + "\r\n\r\n";
+
+            if ( file_ ) ranges_.push_back(FileRange{r.first, r.second - r.first + 1, std::move(prefix)});
+            else {
+                body += prefix;
+                body.append(content_, r.first, r.second - r.first + 1);
+            }
+        }
+
+        string suffix = string("\r\n--") + boundary + "--\r\n";
+        if ( file_ ) ranges_suffix_ = suffix;
+        else content_ = body + suffix;
+    }
+
+    setContentLength();
+    return true;
 }
 
 void Response::writeJSON(const string &obj){
@@ -341,6 +727,8 @@ void Response::writeJSONVariant(const Variant &var){
 }
 
 void Response::write(const string &content, const string &mime){
+    file_.reset();
+    generator_ = nullptr;
     content_.assign(content);
     setContentType(mime);
     setContentLength();
@@ -352,18 +740,37 @@ void Response::setContentType(const string &mime) {
 }
 
 void Response::setContentLength() {
-    headers_.replace("Content-Length", to_string(content_.size()));
+    headers_.replace("Content-Length", to_string(contentLength()));
+}
+
+uint64_t Response::contentLength() const {
+    if ( !file_ ) return content_.size();
+    if ( ranges_.empty() ) return file_->size();
+
+    uint64_t length = ranges_suffix_.size();
+    for( const auto &r: ranges_ )
+        length += r.prefix_.size() + r.length_;
+    return length;
 }
 
 void Response::append(const string &content){
     content_.append(content);
 }
 
+void Response::stream(const ContentGenerator &generator, const string &mime){
+    file_.reset();
+    content_.clear();
+    generator_ = generator;
+    headers_.remove("Content-Length");
+    setContentType(mime);
+    setStatus(ok);
+}
+
 void Response::setCookie(const string &name, const string &value, time_t expires, const string &path, const string &domain, bool secure, bool http_only){
     string cookie = name + '=' + value;
     if ( expires > 0 ) {
-        char etime_buf[64];
-        gmt_time_string(etime_buf, sizeof(etime_buf), &expires);
+        char etime_buf[detail::HttpDate::size + 1];
+        detail::HttpDate::format(expires, etime_buf);
         cookie += "; Expires="; cookie += etime_buf;
     }
 
@@ -379,7 +786,7 @@ void Response::setCookie(const string &name, const string &value, time_t expires
     if ( http_only )
         cookie += "; HttpOnly";
 
-    headers_.add("Set-Cookie", cookie);
+    headers_.append("Set-Cookie", cookie);
 }
 } // namespace server
 } // namespace wspp
@@ -1,9 +1,9 @@
 #include <wspp/server/route.hpp>
 #include <boost/regex.hpp>
-#include <boost/thread.hpp>
 #include <boost/algorithm/string.hpp>
 
 #include <cassert>
+#include <iostream>
 
 using namespace std;
 using namespace wspp::util;
@@ -23,15 +23,19 @@ public:
     RouteImpl(const std::string &pattern) {
         if ( pattern.back() == '/' ) pattern_ = pattern;
         else pattern_ = pattern + '/';
-        assert(parse(pattern_));
+        bool parsed = parse(pattern_);
+        assert(parsed);
+        if ( parsed ) makeRegex();
     }
     bool parse(const string &pattern);
-    bool makeRegex();
-    bool match(const string &path, Dictionary &vars);
+    void makeRegex();
+    bool match(const string &path, Dictionary &vars) const;
     string url(const Dictionary &params, bool relative) const;
 
     vector<RouteElement> elements_;
     string pattern_;
+    // compiled once, matching only reads it so that routes may be matched from any thread without locking
+    boost::regex regex_;
 };
 
 bool RouteImpl::parse(const string &pattern) {
@@ -81,58 +85,27 @@ bool RouteImpl::parse(const string &pattern) {
     return true;
 }
 
-class UriPatternMatcher {
-public:
-    bool matches(const string &pattern, const RouteImpl &route, const string &uri, Dictionary &vars);
-
-    static UriPatternMatcher &instance() {
-        static UriPatternMatcher the_instance;
-        return the_instance;
-    }
+bool RouteImpl::match(const string &path, Dictionary &vars) const {
+    if ( regex_.empty() ) return false;
 
-private:
-    boost::regex makeRegexFromPattern(const string &pat, const RouteImpl &route_data);
-    bool matchPattern(const boost::regex &rx, const RouteImpl &route, const string &path, Dictionary &vars);
-
-    std::map<std::string, boost::regex> cache_;
-    mutable boost::mutex cache_mutex_;
-};
-
-bool UriPatternMatcher::matchPattern(const boost::regex &rx, const RouteImpl &route, const string &path, Dictionary &vars){
     boost::smatch results;
-    if ( boost::regex_match(path, results, rx) ) {
-        for( const RouteElement &e: route.elements_ ) {
-            if ( !e.name_.empty() ) {
-                string val = results[e.name_].str();
-                if ( !val.empty() ) vars[e.name_] = val;
-            }
-        }
+    if ( !boost::regex_match(path, results, regex_) ) return false;
 
-        return true;
+    for( const RouteElement &e: elements_ ) {
+        if ( !e.name_.empty() ) {
+            string val = results[e.name_].str();
+            if ( !val.empty() ) vars[e.name_] = val;
+        }
     }
 
-    return false;
-}
-
-bool UriPatternMatcher::matches(const string &pattern, const RouteImpl &route, const string &uri, Dictionary &vars) {
-    boost::unique_lock<boost::mutex> l(cache_mutex_);
-
-    auto it = cache_.find(pattern);
-    if ( it != cache_.end() )  // pattern exists in cache
-        return matchPattern(it->second, route, uri, vars);
-    else {
-        boost::regex rxs = makeRegexFromPattern(pattern, route);
-        bool res = matchPattern(rxs, route, uri, vars);
-        cache_[pattern] = std::move(rxs);
-        return res;
-    }
+    return true;
 }
 
-boost::regex  UriPatternMatcher::makeRegexFromPattern(const string &pat, const RouteImpl &route) {
+void RouteImpl::makeRegex() {
     string rx;
 
     vector<string> patterns;
-    for( const RouteElement &e: route.elements_ ) {
+    for( const RouteElement &e: elements_ ) {
         string param = e.name_;
         string pattern = e.pattern_;
 
@@ -145,10 +118,10 @@ boost::regex  UriPatternMatcher::makeRegexFromPattern(const string &pat, const R
             patterns.push_back( "(?:" + pattern + ")");
     }
 
-    auto it = route.elements_.begin();
+    auto it = elements_.begin();
     auto pit = patterns.begin();
 
-    for( ; it != route.elements_.end(); ++it, ++pit ) {
+    for( ; it != elements_.end(); ++it, ++pit ) {
         const RouteElement &e = *it;
 
         if ( e.optional_ ) rx += "(?:" + *pit + "\\/)?" ;
@@ -158,18 +131,12 @@ boost::regex  UriPatternMatcher::makeRegexFromPattern(const string &pat, const R
     rx = "^\\/" + rx + '$';
 
     try {
-        boost::regex res(rx, boost::regex::perl);
-        return res;
+        regex_.assign(rx, boost::regex::perl);
     } catch ( boost::bad_expression &e ) {
-        cout << e.what() << endl;
-        return boost::regex();
+        cerr << e.what() << endl;
     }
 }
 
-bool RouteImpl::match(const string &path, Dictionary &data) {
-    return UriPatternMatcher::instance().matches(pattern_, *this, path, data);
-}
-
 string RouteImpl::url(const Dictionary &params, bool relative) const {
     string res;
     if ( !relative ) res += '/';
@@ -195,14 +162,14 @@ Route::Route(const string &pattern): impl_(new RouteImpl(pattern)) {
 
 Route::~Route() {}
 
-static string get_clean_path(const std::string &path){
-    if ( path.back() != '/' ) return path + '/';
-    else return path;
+const string &Route::pattern() const {
+    return impl_->pattern_;
 }
 
 bool Route::matches(const string &path, Dictionary &data) const {
-    return impl_->match(get_clean_path(path), data);
-
+    // the pattern ends with a slash
+    if ( !path.empty() && path.back() == '/' ) return impl_->match(path, data);
+    else return impl_->match(path + '/', data);
 }
 
 bool Route::matches(const string &path) const {
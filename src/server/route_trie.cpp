@@ -0,0 +1,186 @@
+#include <wspp/server/detail/route_trie.hpp>
+
+#include <boost/regex.hpp>
+#include <boost/algorithm/string.hpp>
+
+#include <map>
+#include <algorithm>
+#include <stdexcept>
+
+using namespace std;
+
+namespace wspp {
+namespace server {
+namespace detail {
+
+struct RouteTrie::Param {
+    enum Type { Any, Digits, Word, Choice, Regex };
+
+    Param(const string &name, const string &pattern);
+
+    bool matches(const string &segment) const;
+
+    string name_, pattern_;
+    Type type_;
+    vector<string> choices_;
+    boost::regex regex_;
+    std::unique_ptr<Node> child_;
+};
+
+struct RouteTrie::Node {
+    struct Endpoint {
+        vector<string> methods_;
+        size_t id_;
+    };
+
+    map<string, std::unique_ptr<Node>> literals_;
+    vector<std::unique_ptr<Param>> params_;
+    // the routes ending at this node in the order they were added
+    vector<Endpoint> endpoints_;
+};
+
+static bool is_word_char(char c) {
+    return isalnum((unsigned char)c) || c == '_';
+}
+
+RouteTrie::Param::Param(const string &name, const string &pattern): name_(name), pattern_(pattern) {
+    if ( pattern.empty() ) type_ = Any;
+    else if ( pattern == "\\d+" || pattern == "[\\d]+" || pattern == "[0-9]+" ) type_ = Digits;
+    else if ( pattern == "\\w+" || pattern == "[\\w]+" ) type_ = Word;
+    else if ( std::all_of(pattern.begin(), pattern.end(), [] (char c) { return is_word_char(c) || c == '-' || c == '|'; }) ) {
+        type_ = Choice;
+        boost::split(choices_, pattern, boost::is_any_of("|"));
+    }
+    else {
+        type_ = Regex;
+        regex_.assign(pattern, boost::regex::perl);
+    }
+}
+
+bool RouteTrie::Param::matches(const string &segment) const {
+    switch ( type_ ) {
+    case Any:
+        return true;
+    case Digits:
+        return std::all_of(segment.begin(), segment.end(), [] (char c) { return isdigit((unsigned char)c); });
+    case Word:
+        return std::all_of(segment.begin(), segment.end(), is_word_char);
+    case Choice:
+        return std::find(choices_.begin(), choices_.end(), segment) != choices_.end();
+    default:
+        return boost::regex_match(segment, regex_);
+    }
+}
+
+RouteTrie::RouteTrie(): root_(new Node) {}
+
+RouteTrie::~RouteTrie() {}
+
+// the path segments between slashes, ignoring a leading and a trailing slash
+static void split_path(const string &path, vector<string> &segments) {
+    size_t start = ( !path.empty() && path[0] == '/' ) ? 1 : 0, end = path.size();
+    if ( end > start && path[end-1] == '/' ) end--;
+    if ( end <= start ) return;
+
+    while ( true ) {
+        size_t pos = path.find('/', start);
+        if ( pos == string::npos || pos >= end ) {
+            segments.emplace_back(path, start, end - start);
+            return;
+        }
+        segments.emplace_back(path, start, pos - start);
+        start = pos + 1;
+    }
+}
+
+void RouteTrie::add(const string &methods, const string &pattern, size_t id) {
+    vector<string> segments;
+    split_path(pattern, segments);
+
+    Node::Endpoint endpoint;
+    boost::split(endpoint.methods_, methods, boost::is_any_of(" |"), boost::token_compress_on);
+    endpoint.id_ = id;
+
+    if ( patterns_.size() <= id ) patterns_.resize(id + 1);
+    patterns_[id] = pattern.empty() || pattern.back() != '/' ? pattern + '/' : pattern;
+
+    Node *node = root_.get();
+    for( string segment: segments ) {
+        // an optional element and the elements after it may be missing, so the route also ends before it
+        if ( !segment.empty() && segment.back() == '?' ) {
+            segment.pop_back();
+            node->endpoints_.push_back(endpoint);
+        }
+
+        if ( segment.empty() ) throw std::invalid_argument("empty segment in route pattern: " + pattern);
+
+        if ( segment.front() != '{' ) {
+            std::unique_ptr<Node> &child = node->literals_[segment];
+            if ( !child ) child.reset(new Node);
+            node = child.get();
+            continue;
+        }
+
+        if ( segment.back() != '}' ) throw std::invalid_argument("invalid parameter in route pattern: " + pattern);
+
+        string param = segment.substr(1, segment.size() - 2), name, regex;
+        size_t colon = param.find(':');
+        name = param.substr(0, colon);
+        if ( colon != string::npos ) regex = param.substr(colon + 1);
+
+        // routes with the same parameter at the same place share the node
+        Param *p = nullptr;
+        for( const auto &existing: node->params_ )
+            if ( existing->name_ == name && existing->pattern_ == regex ) p = existing.get();
+
+        if ( !p ) {
+            node->params_.emplace_back(new Param(name, regex));
+            p = node->params_.back().get();
+            p->child_.reset(new Node);
+        }
+
+        node = p->child_.get();
+    }
+
+    node->endpoints_.push_back(endpoint);
+}
+
+bool RouteTrie::match(const string &method, const string &path, size_t &id, util::Dictionary &attributes) const {
+    vector<string> segments;
+    split_path(path, segments);
+
+    return match(*root_, segments, 0, method, id, attributes);
+}
+
+bool RouteTrie::match(const Node &node, const vector<string> &segments, size_t pos, const string &method,
+                      size_t &id, util::Dictionary &attributes) const {
+    if ( pos == segments.size() ) {
+        for( const Node::Endpoint &e: node.endpoints_ ) {
+            if ( std::find(e.methods_.begin(), e.methods_.end(), method) != e.methods_.end() ) {
+                id = e.id_;
+                return true;
+            }
+        }
+        return false;
+    }
+
+    const string &segment = segments[pos];
+    if ( segment.empty() ) return false;
+
+    auto it = node.literals_.find(segment);
+    if ( it != node.literals_.end() && match(*it->second, segments, pos + 1, method, id, attributes) )
+        return true;
+
+    for( const auto &p: node.params_ ) {
+        if ( p->matches(segment) && match(*p->child_, segments, pos + 1, method, id, attributes) ) {
+            if ( !p->name_.empty() ) attributes[p->name_] = segment;
+            return true;
+        }
+    }
+
+    return false;
+}
+
+} // namespace detail
+} // namespace server
+} // namespace wspp
@@ -1,15 +1,75 @@
 #include <wspp/server/server.hpp>
 #include <wspp/server/detail/connection.hpp>
-#include <boost/make_shared.hpp>
+#include <wspp/server/detail/http_date.hpp>
+
+#include <atomic>
 
 namespace wspp { namespace server {
 
+// maximum number of unused connection objects kept for each thread
+static const std::size_t max_pooled_connections = 256;
+
+// time allowed to a turned away client to read the canned response before its connection is closed
+static const std::size_t rejected_linger_time = 1;
+
+// A connection turned away with a canned response. The send side is shut down after the response and the request is
+// read and discarded until the client closes, since closing with unread data makes the kernel reset the connection and
+// the client may lose the response.
+class RejectedConnection: public std::enable_shared_from_this<RejectedConnection> {
+public:
+    RejectedConnection(boost::asio::io_service &io, boost::asio::ip::tcp::socket &&socket):
+        socket_(std::move(socket)), timer_(io) {}
+
+    void start() {
+        auto self(shared_from_this());
+
+        timer_.expires_from_now(std::chrono::seconds(rejected_linger_time));
+        timer_.async_wait([self] (const boost::system::error_code &e) {
+            if ( e != boost::asio::error::operation_aborted ) self->close();
+        });
+
+        boost::asio::async_write(socket_, overload_response(), [self] (boost::system::error_code e, std::size_t) {
+            if ( e ) {
+                self->close();
+                return;
+            }
+            self->socket_.shutdown(boost::asio::ip::tcp::socket::shutdown_send, e);
+            self->drain();
+        });
+    }
+
+private:
+    void drain() {
+        auto self(shared_from_this());
+        socket_.async_read_some(boost::asio::buffer(buffer_), [self] (boost::system::error_code e, std::size_t) {
+            if ( e ) self->close();
+            else self->drain();
+        });
+    }
+
+    void close() {
+        boost::system::error_code ignored_ec;
+        timer_.cancel(ignored_ec);
+        socket_.close(ignored_ec);
+    }
+
+    boost::asio::ip::tcp::socket socket_;
+    boost::asio::steady_timer timer_;
+    char buffer_[1024];
+};
+
+#if defined(SO_REUSEPORT)
+typedef boost::asio::detail::socket_option::boolean<SOL_SOCKET, SO_REUSEPORT> reuse_port_option;
+#endif
+
 Server::Server(const std::string& address, const std::string& port,
-               std::size_t io_service_pool_size)
+               std::size_t io_service_pool_size, bool reuse_port)
     : io_service_pool_(io_service_pool_size),
-      signals_(io_service_pool_.get_io_service()),
-      acceptor_(io_service_pool_.get_io_service()),
-      socket_(io_service_pool_.get_io_service()){
+      signals_(io_service_pool_.get_io_service(0)),
+      date_timer_(io_service_pool_.get_io_service(0)),
+      connection_pool_(std::make_shared<detail::ConnectionPool>(io_service_pool_size, max_pooled_connections)){
+    connection_options_.admission_ = &admission_;
+
     // Register to handle the signals that indicate when the server should exit.
     // It is safe to register for the same signal multiple times in a program,
     // provided all registration for the specified signal is made through Asio.
@@ -21,16 +81,41 @@ Server::Server(const std::string& address, const std::string& port,
 
     do_await_stop();
 
-    // Open the acceptor with the option to reuse the address (i.e. SO_REUSEADDR).
-    boost::asio::ip::tcp::resolver resolver(acceptor_.get_io_service());
+    boost::asio::ip::tcp::resolver resolver(io_service_pool_.get_io_service(0));
     boost::asio::ip::tcp::resolver::query query(address, port);
     boost::asio::ip::tcp::endpoint endpoint = *resolver.resolve(query);
 
-    acceptor_.open(endpoint.protocol());
-    acceptor_.set_option(boost::asio::ip::tcp::acceptor::reuse_address(true));
-    acceptor_.bind(endpoint);
-    acceptor_.listen();
+    std::size_t num_listeners = reuse_port ? io_service_pool_.size() : 1;
 
+#if !defined(SO_REUSEPORT)
+    if ( reuse_port )
+        throw std::runtime_error("SO_REUSEPORT is not supported on this platform");
+#endif
+
+    for( std::size_t i=0 ; i<num_listeners ; i++ ) {
+        boost::asio::io_service &io = io_service_pool_.get_io_service(i);
+        // connections accepted by a shared acceptor are registered in a shard per thread of the pool
+        std::unique_ptr<Listener> listener(new Listener(io, reuse_port ? 1 : io_service_pool_.size()));
+        listener->io_service_ = reuse_port ? &io : nullptr;
+        listener->io_service_index_ = i;
+
+        // Open the acceptor with the option to reuse the address (i.e. SO_REUSEADDR).
+        boost::asio::ip::tcp::acceptor &acceptor = listener->acceptor_;
+        acceptor.open(endpoint.protocol());
+        acceptor.set_option(boost::asio::ip::tcp::acceptor::reuse_address(true));
+#if defined(SO_REUSEPORT)
+        if ( reuse_port )
+            acceptor.set_option(reuse_port_option(true));
+#endif
+        acceptor.bind(endpoint);
+        acceptor.listen();
+
+        // the other acceptors share the port chosen by the system for the first one
+        if ( endpoint.port() == 0 )
+            endpoint.port(acceptor.local_endpoint().port());
+
+        listeners_.emplace_back(std::move(listener));
+    }
 }
 
 void Server::addFilter(Filter *filter) {
@@ -42,38 +127,165 @@ void Server::setHandler(RequestHandler *handler) {
     filters_.setEndPoint(handler);
 }
 
+void Server::setKeepAlive(std::size_t timeout, std::size_t max_requests) {
+    connection_options_.keep_alive_timeout_ = timeout;
+    connection_options_.max_keep_alive_requests_ = max_requests;
+}
+
+void Server::setTimeouts(std::size_t header_timeout, std::size_t body_timeout, std::size_t write_timeout) {
+    connection_options_.header_timeout_ = header_timeout;
+    connection_options_.body_timeout_ = body_timeout;
+    connection_options_.write_timeout_ = write_timeout;
+}
+
+void Server::setWorkerPool(std::size_t num_threads, std::size_t max_queue) {
+    worker_pool_.reset(new detail::WorkerPool(num_threads, max_queue));
+    connection_options_.worker_pool_ = worker_pool_.get();
+    setQueueDelay(queue_target_, queue_interval_);
+}
+
+void Server::setQueueDelay(std::size_t target, std::size_t interval) {
+    queue_target_ = target;
+    queue_interval_ = interval;
+    if ( worker_pool_ )
+        worker_pool_->setQueueDelay(std::chrono::milliseconds(target), std::chrono::milliseconds(interval));
+}
+
+void Server::setMetrics(MetricsRegistry &registry) {
+    connection_metrics_.reset(new ConnectionMetrics{
+        registry.counter("http_received_bytes_total", "Bytes received from clients."),
+        registry.counter("http_sent_bytes_total", "Bytes of responses sent to clients."),
+        registry.histogram("http_response_write_seconds", "Time spent sending responses.")
+    });
+    connection_options_.metrics_ = connection_metrics_.get();
+
+    registry.sampledGauge("http_open_connections", "Open client connections.",
+                          [this] { return (double)stats().open_connections_; });
+    registry.sampledGauge("http_in_flight_requests", "Requests being handled or waiting for a worker.",
+                          [this] { return (double)stats().in_flight_requests_; });
+    registry.sampledGauge("http_queued_requests", "Requests waiting for a worker.",
+                          [this] { return (double)stats().queued_requests_; });
+    registry.sampledCounter("http_accepted_connections_total", "Connections accepted.",
+                            [this] { return (double)stats().accepted_connections_; });
+    registry.sampledCounter("http_rejected_connections_total", "Connections closed at once because of the connection limits.",
+                            [this] { return (double)stats().rejected_connections_; });
+    registry.sampledCounter("http_rejected_requests_total", "Requests refused because of the in-flight limit or a full worker queue.",
+                            [this] { return (double)stats().rejected_requests_; });
+    registry.sampledCounter("http_dropped_requests_total", "Requests refused because they waited too long for a worker.",
+                            [this] { return (double)stats().dropped_requests_; });
+}
+
+ServerStats Server::stats() const {
+    ServerStats s = admission_.stats();
+    if ( worker_pool_ ) s.queued_requests_ = worker_pool_->queued();
+    return s;
+}
+
+void Server::setUploadSpooling(std::size_t spool_size, const std::string &folder) {
+    connection_options_.upload_spool_size_ = spool_size;
+    connection_options_.upload_dir_ = folder;
+}
+
 void Server::run(){
-    start_accept();
-    io_service_pool_.run();
+    if ( worker_pool_ )
+        worker_pool_->start();
+
+    for( auto &listener: listeners_ )
+        start_accept(*listener);
+    update_date();
+    io_service_pool_.run(pin_threads_);
+
+    if ( worker_pool_ )
+        worker_pool_->stop();
 }
 
-void Server::start_accept(){
-    //new_connection_.reset(new connection(io_service_pool_.get_io_service(), handler_factory_));
-    acceptor_.async_accept(socket_, [this] ( const boost::system::error_code& e ){
+void Server::start_accept(Listener &listener){
+    listener.new_connection_index_ = listener.io_service_ ? 0 : io_service_pool_.next_index();
+    boost::asio::io_service &io = listener.io_service_ ? *listener.io_service_ :
+                                                         io_service_pool_.get_io_service(listener.new_connection_index_);
+
+    std::size_t io_index = listener.io_service_ ? listener.io_service_index_ : listener.new_connection_index_;
+    listener.new_connection_ = connection_pool_->create(io_index, io, listener.connection_manager_,
+                                                        filters_, connection_options_);
+
+    listener.acceptor_.async_accept(listener.new_connection_->socket(), [this, &listener] ( const boost::system::error_code& e ){
 
         // Check whether the server was stopped by a signal before this
              // completion handler had a chance to run.
-             if (!acceptor_.is_open())
+             if (!listener.acceptor_.is_open())
              {
                return;
              }
 
              if (!e)
              {
+               ConnectionPtr &c = listener.new_connection_;
+               boost::system::error_code ec;
+               boost::asio::ip::tcp::endpoint remote = c->socket().remote_endpoint(ec);
 
-               connection_manager_.start(boost::make_shared<HttpConnection>(
-                   std::move(socket_), connection_manager_, filters_));
+               if ( ec ) {
+                   c->socket().close(ec);
+               }
+               else if ( !connections_per_address_.acquire(remote.address(), connection_options_.max_connections_per_address_) ) {
+                   admission_.connectionRejected();
+                   c->socket().close(ec);
+               }
+               else if ( !admission_.acquireConnection(max_connections_) ) {
+                   connections_per_address_.release(remote.address());
+                   // turn the client away with a canned response, the connection object is left for the next client
+                   std::make_shared<RejectedConnection>(c->io_service_, std::move(c->socket()))->start();
+               }
+               else {
+                   c->remote_address_ = remote.address();
+                   c->address_counter_ = &connections_per_address_;
+                   c->connection_counter_ = &admission_;
+                   listener.connection_manager_.start(c, listener.new_connection_index_);
+               }
              }
 
-        //if (!e) new_connection_->start();
-        start_accept();
+        start_accept(listener);
+    });
+}
+
+void Server::update_date() {
+    detail::HttpDate::update();
+
+    date_timer_.expires_from_now(std::chrono::seconds(1));
+    date_timer_.async_wait([this] (const boost::system::error_code &e) {
+        if ( e != boost::asio::error::operation_aborted ) update_date();
     });
 }
 
 void Server::handle_stop(){
-    acceptor_.close();
-    connection_manager_.stop_all();
-    io_service_pool_.stop();
+    // acceptors and connections are not thread-safe, so each is closed on the thread of its io_service, and the pool
+    // is stopped once all of them are closed
+    auto pending = std::make_shared<std::atomic<std::size_t>>(io_service_pool_.size());
+
+    for( std::size_t i=0 ; i<io_service_pool_.size() ; i++ ) {
+        io_service_pool_.get_io_service(i).post([this, i, pending] {
+            stop_io_service(i);
+            if ( --*pending == 0 ) io_service_pool_.stop();
+        });
+    }
+}
+
+void Server::stop_io_service(std::size_t index){
+    boost::system::error_code ignored_ec;
+    if ( index == 0 ) date_timer_.cancel(ignored_ec);
+
+    for( auto &listener: listeners_ ) {
+        if ( listener->io_service_ ) {
+            // SO_REUSEPORT: the acceptor and its connections run on the io_service of the listener
+            if ( listener->io_service_index_ != index ) continue;
+            listener->acceptor_.close(ignored_ec);
+            listener->connection_manager_.stop_all();
+        }
+        else {
+            // the shared acceptor runs on the first io_service, its connections are in a shard per io_service
+            if ( index == 0 ) listener->acceptor_.close(ignored_ec);
+            listener->connection_manager_.stop_all(index);
+        }
+    }
 }
 
 
@@ -92,6 +304,10 @@ void Server::stop(){
     handle_stop();
 }
 
+unsigned short Server::port() const {
+    return listeners_.front()->acceptor_.local_endpoint().port();
+}
+
 
 } // namespace server
 } // namespace wspp
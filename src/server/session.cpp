@@ -18,13 +18,13 @@ Session::Session(SessionHandler &handler, const Request &req, Response &resp, co
             id_ = handler_.uniqueSID();
             resp.setCookie(key_name, id_, 0, handler.cookiePath(), handler.cookieDomain() );
         }
-        else
-            handler_.read(*this);
+        else if ( handler_.read(*this) )
+            stored_ = data_;
     }
 }
 
 Session::~Session() {
-    handler_.write(*this);
+    if ( data_ != stored_ ) handler_.write(*this);
     handler_.close();
 }
 } // namespace server
@@ -0,0 +1,78 @@
+#include <wspp/server/detail/worker_pool.hpp>
+
+#include <stdexcept>
+#include <boost/bind.hpp>
+
+namespace wspp {
+namespace server {
+namespace detail {
+
+WorkerPool::WorkerPool(std::size_t num_threads, std::size_t max_queue):
+    num_threads_(num_threads), max_queue_(max_queue), queued_(0), target_(0), interval_(0), min_delay_(0) {
+    if ( num_threads == 0 )
+        throw std::runtime_error("worker pool size is 0");
+}
+
+WorkerPool::~WorkerPool() {
+    stop();
+}
+
+void WorkerPool::start() {
+    work_.reset(new boost::asio::io_service::work(io_service_));
+    for( std::size_t i = 0 ; i < num_threads_ ; i++ )
+        threads_.create_thread(boost::bind(&boost::asio::io_service::run, &io_service_));
+}
+
+void WorkerPool::stop() {
+    work_.reset();
+    io_service_.stop();
+    threads_.join_all();
+}
+
+bool WorkerPool::post(const Task &task) {
+    if ( ++queued_ > max_queue_ && max_queue_ ) {
+        --queued_;
+        return false;
+    }
+
+    if ( interval_ == Clock::duration::zero() ) {
+        io_service_.post([this, task] {
+            --queued_;
+            task(true);
+        });
+    } else {
+        Clock::time_point queued_at = Clock::now();
+        io_service_.post([this, task, queued_at] {
+            --queued_;
+            Clock::time_point now = Clock::now();
+            task(!shouldDrop(now, now - queued_at));
+        });
+    }
+
+    return true;
+}
+
+void WorkerPool::setQueueDelay(std::chrono::milliseconds target, std::chrono::milliseconds interval) {
+    target_ = target;
+    interval_ = interval;
+}
+
+bool WorkerPool::shouldDrop(Clock::time_point now, Clock::duration delay) {
+    boost::unique_lock<boost::mutex> lock(mutex_);
+
+    if ( now - interval_start_ >= interval_ ) {
+        // the queue is overloaded if it did not drain below the target during a whole interval, and not if no task
+        // reached a worker during the last interval (the queue was empty)
+        overloaded_ = min_delay_ > target_ && now - interval_start_ < 2 * interval_;
+        interval_start_ = now;
+        min_delay_ = delay;
+    }
+    else if ( delay < min_delay_ )
+        min_delay_ = delay;
+
+    return delay > ( overloaded_ ? target_ : interval_ );
+}
+
+} // namespace detail
+} // namespace server
+} // namespace wspp
@@ -36,7 +36,7 @@ void Dictionary::removeSome(const regex &rx){
 }
 
 void Dictionary::clear() {
-    clear();
+    SSMap::clear();
 }
 
 string Dictionary::get(const string &key, const string &defaultVal) const{
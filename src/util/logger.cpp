@@ -304,7 +304,7 @@ void Logger::addAppender(const std::shared_ptr<LogAppender> &appender){
 }
 
 void Logger::write_impl(LogLevel level, const LogContext &ctx, const string &message){
-//    boost::mutex::scoped_lock lock(lock_);
+    lock_guard<mutex> lock(lock_);
 
     for(int i=0; i<appenders_.size(); i++)
         appenders_[i]->append(level, ctx, message);
@@ -0,0 +1,141 @@
+#include <wspp/server/server.hpp>
+#include <wspp/server/request_handler.hpp>
+
+#include <boost/thread.hpp>
+
+#include <atomic>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <new>
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+using namespace std;
+using namespace wspp::server;
+
+// Counts the heap allocations made by the server while serving requests over a persistent connection and
+// over a new connection per request. The client uses plain sockets so that all allocations are the server's.
+
+static std::atomic<size_t> num_allocations(0);
+
+void *operator new(size_t size) {
+    ++num_allocations;
+    if ( void *p = malloc(size ? size : 1) ) return p;
+    throw std::bad_alloc();
+}
+
+void operator delete(void *p) noexcept {
+    free(p);
+}
+
+void operator delete(void *p, size_t) noexcept {
+    free(p);
+}
+
+// port chosen by the system for the server
+static unsigned short port = 0;
+
+class HelloHandler: public RequestHandler {
+public:
+    void handle(const Request &req, Response &resp) override {
+        resp.write("hello " + req.path_, "text/plain");
+    }
+};
+
+static int open_connection() {
+    int fd = socket(AF_INET, SOCK_STREAM, 0);
+    sockaddr_in addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(port);
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    if ( connect(fd, (sockaddr *)&addr, sizeof(addr)) != 0 ) {
+        cerr << "cannot connect" << endl;
+        exit(1);
+    }
+    return fd;
+}
+
+// send a request and read the response up to its (short) body
+static bool round_trip(int fd, const char *request) {
+    static char buf[4096];
+    size_t len = strlen(request);
+    if ( send(fd, request, len, 0) != (ssize_t)len ) return false;
+
+    size_t received = 0;
+    while ( true ) {
+        ssize_t n = recv(fd, buf + received, sizeof(buf) - received - 1, 0);
+        if ( n <= 0 ) return received > 0;
+        received += n;
+        buf[received] = 0;
+        const char *body = strstr(buf, "\r\n\r\n");
+        if ( body && strstr(body, "hello") ) return true;
+    }
+}
+
+static const char *keep_alive_request =
+        "GET /index HTTP/1.1\r\n"
+        "Host: localhost\r\n"
+        "User-Agent: Mozilla/5.0 (X11; Linux x86_64; rv:54.0) Gecko/20100101 Firefox/54.0\r\n"
+        "Accept: text/html,application/xhtml+xml,application/xml;q=0.9,*/*;q=0.8\r\n"
+        "Accept-Encoding: gzip, deflate, br\r\n"
+        "Connection: keep-alive\r\n"
+        "\r\n";
+
+static const char *close_request =
+        "GET /index HTTP/1.1\r\n"
+        "Host: localhost\r\n"
+        "Connection: close\r\n"
+        "\r\n";
+
+int main() {
+    const int num_requests = 10000;
+    const int num_connections = 1000;
+
+    // the server listens once constructed, so the client may connect before run() is called
+    Server server("127.0.0.1", "0", 1);
+    server.setHandler(new HelloHandler());
+    server.setKeepAlive(5, num_requests * 2);
+    port = server.port();
+
+    boost::thread t([&server] { server.run(); });
+
+    int fd = open_connection();
+    for( int i = 0 ; i < 100 ; i++ ) round_trip(fd, keep_alive_request);
+
+    size_t start = num_allocations;
+    for( int i = 0 ; i < num_requests ; i++ ) {
+        if ( !round_trip(fd, keep_alive_request) ) {
+            cerr << "request failed" << endl;
+            return 1;
+        }
+    }
+    cout << "keep-alive: " << double(num_allocations - start)/num_requests << " allocations/request" << endl;
+    close(fd);
+
+    for( int i = 0 ; i < 100 ; i++ ) {
+        fd = open_connection();
+        round_trip(fd, close_request);
+        close(fd);
+    }
+
+    start = num_allocations;
+    for( int i = 0 ; i < num_connections ; i++ ) {
+        fd = open_connection();
+        if ( !round_trip(fd, close_request) ) {
+            cerr << "request failed" << endl;
+            return 1;
+        }
+        close(fd);
+    }
+    cout << "connection per request: " << double(num_allocations - start)/num_connections << " allocations/request" << endl;
+
+    server.stop();
+    t.join();
+
+    return 0;
+}
@@ -0,0 +1,195 @@
+#include <wspp/server/detail/multipart_parser.hpp>
+#include <wspp/server/request.hpp>
+
+#include <boost/algorithm/string.hpp>
+#include <boost/regex.hpp>
+
+#include <chrono>
+#include <iostream>
+#include <random>
+#include <sstream>
+
+using namespace std;
+using namespace wspp::server;
+
+// Compares the incremental multipart/form-data parser with the original implementation that scanned a
+// stringstream copy of the body one character at a time, on uploads of 1KB, 1MB and 20MB.
+
+namespace legacy {
+static std::string get_next_line(std::istream &strm, int maxc = 1000){
+    std::string res;
+    char b0, b1;
+    int count = 0;
+
+    while ( count < maxc && !strm.eof() ) {
+        b0 = strm.get();
+        count ++;
+
+        if ( b0 == '\r' )
+        {
+            b1 = strm.get();
+            count ++;
+
+            if ( b1 == '\n' ) return res;
+            else {
+                res += b0;
+                res += b1;
+            }
+        }
+        else res += b0;
+    }
+
+    return res;
+}
+
+static bool parse_mime_data(Request &session, istream &strm, const string &fld, const string &file_name,
+                          const string &content_type, const string &bnd){
+    std::string data;
+    char b[4] = {0};
+
+    while ( strm ) {
+        char c = strm.get();
+        b[0] = b[1]; b[1] = b[2]; b[2] = b[3]; b[3] = c;
+
+        if ( b[0] == '\r' && b[1] == '\n' && b[2] == '-' && b[3] == '-') {
+            data.resize(data.size() - 3);
+            int bndlen = bnd.length();
+            string buf;
+            buf.resize(bndlen);
+
+            strm.read(&buf[0], bndlen);
+
+            if ( buf == bnd ) {
+                strm.get(); strm.get();
+                break;
+            }
+        }
+        else data.push_back(c);
+    }
+
+    if ( file_name.empty() ) session.POST_[fld] = data;
+    else
+    {
+        static const size_t file_upload_max_size = 20 * 1024 * 1024;
+
+        size_t dsize = data.size();
+
+        if ( dsize <= file_upload_max_size ) {
+            Request::UploadedFile file_info;
+
+            file_info.mime_ = content_type;
+            file_info.name_ = file_name;
+            file_info.data_ = data;
+            file_info.size_ = data.size();
+            session.FILE_.insert({fld, file_info});
+        }
+    }
+
+    return true;
+}
+
+static bool parse_multipart_data(Request &session, istream &strm, const string &bnd){
+    std::string s = get_next_line(strm);
+    if ( s.empty() ) return false;
+    if ( s.compare(2, bnd.length(), bnd ) != 0 ) return false;
+    while ( 1 ) {
+        std::string form_field, file_name, content_type;
+        while ( 1 ) {
+            s = get_next_line(strm);
+            if ( s.empty() ) break;
+
+            size_t pos = s.find(':');
+            if ( pos != string::npos ) {
+                std::string key, val;
+                key.assign(s, 0, pos);
+                boost::trim(key);
+                val.assign(s, pos+1, s.length() - pos);
+                boost::trim(val);
+
+                boost::smatch subm;
+                if ( key == "Content-Disposition" ) {
+                    if ( boost::regex_match(val, subm, boost::regex(R"#(form-data;\s*name="(.*?)(?=")"(?:\s*;\s*filename="(.*?)(?=")")?)#") ) ) {
+                        form_field = subm[1];
+                        file_name = subm[2];
+                    }
+                }
+                else if ( key.compare(0, 12, "Content-Type") == 0 )
+                    content_type = val;
+            }
+        }
+
+        if ( form_field.empty() ) break;
+
+        // Parse content
+        if ( ! parse_mime_data(session, strm, form_field, file_name, content_type, bnd) ) return false;
+    }
+
+    return true;
+}
+} // namespace legacy
+
+static const string boundary = "----WebKitFormBoundary7MA4YWxkTrZu0gW";
+
+static string make_body(size_t file_size) {
+    mt19937 rng(file_size);
+    string data(file_size, 0);
+    for( char &c: data ) c = rng();
+
+    return "--" + boundary + "\r\n"
+           "Content-Disposition: form-data; name=\"title\"\r\n\r\n"
+           "A route\r\n"
+           "--" + boundary + "\r\n"
+           "Content-Disposition: form-data; name=\"gpx-file\"; filename=\"track.gpx\"\r\n"
+           "Content-Type: application/octet-stream\r\n\r\n" +
+           data + "\r\n"
+           "--" + boundary + "--\r\n";
+}
+
+template<class F>
+static double run(size_t iterations, F f) {
+    auto start = chrono::steady_clock::now();
+    for( size_t i = 0 ; i < iterations ; i++ ) f();
+    return chrono::duration<double>(chrono::steady_clock::now() - start).count() / iterations;
+}
+
+int main() {
+    const size_t sizes[] = { 1024, 1024 * 1024, 20 * 1024 * 1024 };
+    const size_t piece = 8192; // size of socket reads
+    int failures = 0;
+
+    for( size_t size: sizes ) {
+        const string body = make_body(size);
+        const size_t iterations = std::max<size_t>(1, (40 * 1024 * 1024) / body.size());
+
+        Request legacy_req, req;
+
+        double t_legacy = run(iterations, [&] {
+            legacy_req = Request();
+            stringstream strm(body);
+            legacy::parse_multipart_data(legacy_req, strm, boundary);
+        });
+
+        double t_new = run(iterations, [&] {
+            req = Request();
+            wspp::server::detail::MultipartParser parser(boundary, 0, string());
+            for( size_t pos = 0 ; pos < body.size() ; pos += piece )
+                parser.feed(body.data() + pos, std::min(piece, body.size() - pos));
+            parser.decode(req);
+        });
+
+        if ( req.POST_.get("title") != legacy_req.POST_.get("title") ||
+             req.FILE_["gpx-file"].data_ != legacy_req.FILE_["gpx-file"].data_ ||
+             req.FILE_["gpx-file"].data_.size() != size ) {
+            cout << "results differ for " << size << " bytes" << endl;
+            failures++;
+        }
+
+        auto mbs = [&](double t) { return body.size() / t / (1024 * 1024); };
+
+        cout << size << " bytes: legacy " << t_legacy * 1e6 << " us (" << mbs(t_legacy) << " MB/s), "
+             << "incremental " << t_new * 1e6 << " us (" << mbs(t_new) << " MB/s), "
+             << "speedup " << t_legacy / t_new << "x" << endl;
+    }
+
+    return failures;
+}
@@ -0,0 +1,86 @@
+#include <wspp/server/detail/request_parser.hpp>
+#include <wspp/server/request.hpp>
+
+#include <chrono>
+#include <iostream>
+#include <vector>
+
+using namespace std;
+using namespace wspp::server;
+
+// Replays typical browser requests through RequestParser::parse and decode_message and reports the
+// number of requests decoded per second.
+
+static const vector<string> requests = {
+    "GET /route/list/?mountain=olympos&page=2&sort=title HTTP/1.1\r\n"
+    "Host: localhost:5000\r\n"
+    "Connection: keep-alive\r\n"
+    "Upgrade-Insecure-Requests: 1\r\n"
+    "User-Agent: Mozilla/5.0 (X11; Linux x86_64) AppleWebKit/537.36 (KHTML, like Gecko) Chrome/58.0.3029.110 Safari/537.36\r\n"
+    "Accept: text/html,application/xhtml+xml,application/xml;q=0.9,image/webp,*/*;q=0.8\r\n"
+    "Referer: http://localhost:5000/route/list/\r\n"
+    "Accept-Encoding: gzip, deflate, sdch, br\r\n"
+    "Accept-Language: el-GR,el;q=0.8,en-US;q=0.6,en;q=0.4\r\n"
+    "Cookie: WSX_SESSION_ID=8c6a5f4e0d1b2a3c4d5e6f708192a3b4; _ga=GA1.1.1234567890.1496000000; lang=el; theme=dark\r\n"
+    "\r\n",
+
+    "GET /track/42/ HTTP/1.1\r\n"
+    "Host: localhost:5000\r\n"
+    "Connection: keep-alive\r\n"
+    "Accept: application/json, text/javascript, */*; q=0.01\r\n"
+    "X-Requested-With: XMLHttpRequest\r\n"
+    "User-Agent: Mozilla/5.0 (Macintosh; Intel Mac OS X 10_12_5) AppleWebKit/603.2.4 (KHTML, like Gecko) Version/10.1.1 Safari/603.2.4\r\n"
+    "Referer: http://localhost:5000/route/view/42\r\n"
+    "Accept-Encoding: gzip, deflate\r\n"
+    "Accept-Language: en-US,en;q=0.8\r\n"
+    "Cookie: WSX_SESSION_ID=8c6a5f4e0d1b2a3c4d5e6f708192a3b4; lang=en\r\n"
+    "\r\n",
+
+    "GET /search?q=mount+olympus%20summit&lat=40.0853&lon=22.3586&radius=5000&format=json&callback=jQuery1124_1496 HTTP/1.1\r\n"
+    "Host: localhost:5000\r\n"
+    "Accept: */*\r\n"
+    "User-Agent: curl/7.52.1\r\n"
+    "\r\n",
+
+    "POST /user/login/ HTTP/1.1\r\n"
+    "Host: localhost:5000\r\n"
+    "Connection: keep-alive\r\n"
+    "Content-Length: 71\r\n"
+    "Cache-Control: max-age=0\r\n"
+    "Origin: http://localhost:5000\r\n"
+    "Content-Type: application/x-www-form-urlencoded\r\n"
+    "User-Agent: Mozilla/5.0 (X11; Linux x86_64; rv:54.0) Gecko/20100101 Firefox/54.0\r\n"
+    "Accept: text/html,application/xhtml+xml,application/xml;q=0.9,*/*;q=0.8\r\n"
+    "Referer: http://localhost:5000/user/login/\r\n"
+    "Accept-Encoding: gzip, deflate, br\r\n"
+    "Cookie: WSX_SESSION_ID=8c6a5f4e0d1b2a3c4d5e6f708192a3b4; _ga=GA1.1.1234567890.1496000000\r\n"
+    "\r\n"
+    "username=admin%40example.com&password=s3cr3t%21%26more&csrf_token=abc123",
+};
+
+int main() {
+    const size_t iterations = 100000;
+    wspp::server::detail::RequestParser parser;
+    size_t failures = 0;
+
+    auto start = chrono::steady_clock::now();
+
+    for( size_t i = 0 ; i < iterations ; i++ ) {
+        for( const string &r: requests ) {
+            parser.reset();
+
+            Request req;
+            if ( !parser.parse(r.data(), r.size()) || !parser.decode_message(req) ) failures++;
+        }
+    }
+
+    double secs = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+    size_t total = iterations * requests.size();
+
+    cout << total << " requests in " << secs << " s, " << total / secs << " requests/s, "
+         << secs / total * 1e9 << " ns/request" << endl;
+
+    if ( failures ) cout << failures << " requests failed to parse" << endl;
+
+    return failures != 0;
+}
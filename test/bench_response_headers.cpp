@@ -0,0 +1,53 @@
+#include <wspp/server/detail/connection.hpp>
+#include <wspp/server/response.hpp>
+
+#include <chrono>
+#include <iostream>
+#include <vector>
+
+using namespace std;
+using namespace wspp::server;
+
+// Serializes typical replies (a small JSON object, an HTML page with cookies and a redirect) with
+// response_to_buffers as the connection does and reports the number of replies serialized per second.
+
+int main() {
+    const size_t iterations = 1000000;
+
+    vector<Response> replies(3);
+
+    replies[0].writeJSON("{\"id\":42,\"title\":\"Olympos\",\"distance\":12.5}");
+    replies[0].headers_.replace("Connection", "keep-alive");
+
+    replies[1].write(string(2048, 'x'));
+    replies[1].setCookie("WSX_SESSION_ID", "8c6a5f4e0d1b2a3c4d5e6f708192a3b4", 0, "/");
+    replies[1].headers_.replace("Cache-Control", "no-cache, no-store, must-revalidate");
+    replies[1].headers_.replace("Connection", "keep-alive");
+
+    replies[2].stockReply(Response::moved_temporarily);
+    replies[2].headers_.replace("Location", "/route/list/");
+    replies[2].headers_.replace("Connection", "close");
+
+    std::string headers;
+    std::vector<boost::asio::const_buffer> buffers;
+    size_t bytes = 0, max_buffers = 0;
+
+    auto start = chrono::steady_clock::now();
+
+    for( size_t i = 0 ; i < iterations ; i++ ) {
+        for( Response &r: replies ) {
+            response_to_buffers(r, false, headers, buffers);
+            bytes += headers.size();
+            max_buffers = std::max(max_buffers, buffers.size());
+        }
+    }
+
+    double secs = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+    size_t total = iterations * replies.size();
+
+    cout << total << " replies in " << secs << " s, " << total / secs << " replies/s, "
+         << secs / total * 1e9 << " ns/reply, " << bytes / total << " header bytes/reply, at most "
+         << max_buffers << " buffers" << endl;
+
+    return max_buffers > 2;
+}
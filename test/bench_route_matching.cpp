@@ -0,0 +1,98 @@
+#include <wspp/server/request.hpp>
+
+#include <boost/thread.hpp>
+
+#include <atomic>
+#include <chrono>
+#include <iostream>
+#include <vector>
+
+using namespace std;
+using namespace wspp::server;
+
+// Matches requests against the routes of the route controller of the routes application with Request::matches, as
+// controllers dispatching route by route do, from 1 and then from n threads (8 by default), and reports the number
+// of requests matched per second. Matching takes no locks so the rate should grow with the number of threads.
+
+static const vector<pair<string, string>> routes {
+    { "GET", "/" }, { "GET", "/mountain/{mountain:[\\w]+}?" }, { "GET", "/routes/edit/" }, { "GET", "/routes/list/" },
+    { "GET|POST", "/routes/add/" }, { "GET|POST", "/routes/update/" }, { "GET", "/route/edit/{id}/" },
+    { "POST", "/route/publish/" }, { "POST", "/routes/delete/" }, { "POST", "/query/route" },
+    { "GET", "/download/track/{format:gpx|kml}/{id}" }, { "GET", "/track/{id}/" }, { "GET", "/view/{id}/" }
+};
+
+static const vector<pair<string, string>> requests {
+    { "GET", "/" }, { "GET", "/mountain/olympos/" }, { "GET", "/view/12/" }, { "GET", "/track/12" },
+    { "GET", "/download/track/kml/12/" }, { "POST", "/query/route/" }, { "GET", "/routes/list/" },
+    { "GET", "/css/bootstrap.min.css" }, { "GET", "/js/map.js" }, { "GET", "/images/markers/peak.png" }
+};
+
+static size_t dispatch(const Request &req) {
+    Dictionary attributes;
+    for( size_t i = 0 ; i < routes.size() ; i++ )
+        if ( req.matches(routes[i].first, routes[i].second, attributes) ) return i;
+    return routes.size();
+}
+
+// requests matched per second by the given number of threads, matched is set to the number of requests that matched
+// a route
+static double run(size_t threads, size_t iterations, size_t &matched) {
+    std::atomic<size_t> num_matched(0);
+
+    auto start = chrono::steady_clock::now();
+
+    boost::thread_group group;
+    for( size_t t = 0 ; t < threads ; t++ ) {
+        group.create_thread([&] {
+            vector<Request> reqs(requests.size());
+            for( size_t i = 0 ; i < requests.size() ; i++ ) {
+                reqs[i].method_ = requests[i].first;
+                reqs[i].path_ = requests[i].second;
+            }
+
+            size_t n = 0;
+            for( size_t k = 0 ; k < iterations ; k++ )
+                for( const Request &req: reqs )
+                    if ( dispatch(req) != routes.size() ) n++;
+
+            num_matched += n;
+        });
+    }
+    group.join_all();
+
+    matched = num_matched;
+
+    double secs = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+    return threads * iterations * requests.size() / secs;
+}
+
+int main(int argc, char *argv[]) {
+    size_t threads = argc > 1 ? stoul(argv[1]) : 8;
+    const size_t iterations = 20000;
+
+    // the requests matching a route when dispatched one at a time
+    size_t expected = 0;
+    for( const auto &r: requests ) {
+        Request req;
+        req.method_ = r.first;
+        req.path_ = r.second;
+        if ( dispatch(req) != routes.size() ) expected++;
+    }
+
+    size_t single_matched, multi_matched;
+    double single = run(1, iterations, single_matched);
+    double multi = run(threads, iterations, multi_matched);
+
+    cout << routes.size() << " routes, 1 thread: " << single << " requests/s, " << threads << " threads: " << multi
+         << " requests/s, speedup " << multi / single << endl;
+
+    cout << expected << " of " << requests.size() << " requests match a route, matched " << single_matched << " and "
+         << multi_matched << " times" << endl;
+
+    if ( single_matched != expected * iterations || multi_matched != expected * iterations * threads ) {
+        cerr << "FAILED" << endl;
+        return 1;
+    }
+
+    return 0;
+}
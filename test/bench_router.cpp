@@ -0,0 +1,98 @@
+#include <wspp/server/router.hpp>
+#include <wspp/server/request.hpp>
+#include <wspp/server/route.hpp>
+
+#include <chrono>
+#include <iostream>
+#include <vector>
+#include <deque>
+
+using namespace std;
+using namespace wspp::server;
+
+// Dispatches requests to the routes of the routes application, once by matching the routes one after the other with
+// Request::matches as the controllers used to and once with a Router, checks that both find the same route with the
+// same parameters and reports the time per request.
+
+static const vector<pair<string, string>> routes {
+    { "GET", "/" }, { "GET", "/mountain/{mountain:[\\w]+}?" }, { "GET", "/routes/edit/" }, { "GET", "/routes/list/" },
+    { "GET|POST", "/routes/add/" }, { "GET|POST", "/routes/update/" }, { "GET", "/route/edit/{id}/" },
+    { "POST", "/route/publish/" }, { "POST", "/routes/delete/" }, { "POST", "/query/route" },
+    { "GET", "/download/track/{format:gpx|kml}/{id}" }, { "GET", "/track/{id}/" }, { "GET", "/view/{id}/" },
+    { "GET", "/map/" },
+    { "GET", "/attachments/{id:\\d+}/list" }, { "GET|POST", "/attachments/{id:\\d+}/add" },
+    { "GET|POST", "/attachments/{id:\\d+}/update" }, { "POST", "/attachments/{id:\\d+}/delete" },
+    { "GET", "/wpts/{id:\\d+}/list" }, { "GET|POST", "/wpts/{id:\\d+}/update" }, { "POST", "/wpts/{id:\\d+}/delete" },
+    { "GET", "/pages/edit/" }, { "GET", "/pages/list/" }, { "GET|POST", "/pages/add/" }, { "GET|POST", "/pages/update/" },
+    { "GET", "/page/edit/{id}/" }, { "POST", "/page/publish/" }, { "POST", "/pages/delete/" }, { "GET", "/page/{id}/" },
+    { "GET", "/users/edit/" }, { "GET", "/users/list/" }, { "GET|POST", "/users/add/" }, { "GET|POST", "/users/update/" },
+    { "POST", "/users/delete/" },
+    { "GET|POST", "/user/login/" }, { "POST", "/user/logout/" }
+};
+
+static const vector<pair<string, string>> requests {
+    { "GET", "/" }, { "GET", "/mountain/olympos/" }, { "GET", "/mountain" }, { "GET", "/view/12/" },
+    { "GET", "/track/12" }, { "GET", "/download/track/kml/12/" }, { "GET", "/download/track/zip/12/" },
+    { "POST", "/query/route/" }, { "GET", "/attachments/7/list" }, { "GET", "/attachments/x/list" },
+    { "POST", "/wpts/3/delete" }, { "GET", "/wpts/3/delete" }, { "GET", "/page/edit/" }, { "GET", "/page/about/" },
+    { "GET", "/users/list/" }, { "POST", "/user/login/" }, { "GET", "/css/bootstrap.min.css" },
+    { "GET", "/js/map.js" }, { "GET", "/images/markers/peak.png" }, { "GET", "/favicon.ico" }
+};
+
+int main() {
+    const size_t iterations = 20000;
+
+    deque<Route> patterns;
+    Router<size_t> router;
+    for( size_t i = 0 ; i < routes.size() ; i++ ) {
+        patterns.emplace_back(routes[i].second);
+        router.add(routes[i].first, routes[i].second, i);
+    }
+
+    vector<Request> reqs(requests.size());
+    for( size_t i = 0 ; i < requests.size() ; i++ ) {
+        reqs[i].method_ = requests[i].first;
+        reqs[i].path_ = requests[i].second;
+    }
+
+    size_t mismatches = 0;
+    for( const Request &req: reqs ) {
+        Dictionary expected, found;
+        size_t route = routes.size();
+        for( size_t i = 0 ; i < routes.size() && route == routes.size() ; i++ )
+            if ( req.matches(routes[i].first, patterns[i], expected) ) route = i;
+
+        const size_t *id = router.match(req, found);
+        if ( ( id ? *id : routes.size() ) != route || expected != found ) {
+            cout << "mismatch: " << req.method_ << ' ' << req.path_ << endl;
+            mismatches++;
+        }
+    }
+
+    size_t matched = 0;
+    auto start = chrono::steady_clock::now();
+    for( size_t n = 0 ; n < iterations ; n++ ) {
+        for( const Request &req: reqs ) {
+            Dictionary attributes;
+            for( size_t i = 0 ; i < routes.size() ; i++ )
+                if ( req.matches(routes[i].first, patterns[i], attributes) ) { matched++; break; }
+        }
+    }
+    double sequential = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+
+    start = chrono::steady_clock::now();
+    for( size_t n = 0 ; n < iterations ; n++ ) {
+        for( const Request &req: reqs ) {
+            Dictionary attributes;
+            if ( router.match(req, attributes) ) matched++;
+        }
+    }
+    double trie = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+
+    size_t total = iterations * reqs.size();
+    cout << routes.size() << " routes, " << matched / 2 / iterations << " of " << reqs.size() << " requests matched, "
+         << "sequential: " << sequential / total * 1e9 << " ns/request, router: " << trie / total * 1e9
+         << " ns/request, " << mismatches << " mismatches" << endl;
+
+    return mismatches != 0;
+}
@@ -0,0 +1,101 @@
+#include <wspp/server/server.hpp>
+#include <wspp/server/async_request_handler.hpp>
+
+#include <boost/asio/steady_timer.hpp>
+#include <boost/thread.hpp>
+
+#include <chrono>
+#include <atomic>
+#include <cstring>
+#include <iostream>
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+using namespace std;
+using namespace wspp::server;
+
+// Requests to a handler that waits on a timer are served concurrently by a single I/O thread.
+
+// port chosen by the system for the server
+static unsigned short port = 0;
+
+class DelayedHandler: public AsyncRequestHandler {
+public:
+    void handle(const Request &req, Response &resp, boost::asio::io_service &io, boost::asio::yield_context yield) override {
+        boost::asio::steady_timer timer(io, std::chrono::milliseconds(200));
+        timer.async_wait(yield);
+        resp.write("done " + req.path_, "text/plain");
+    }
+};
+
+static bool get(const char *path) {
+    int fd = socket(AF_INET, SOCK_STREAM, 0);
+    sockaddr_in addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(port);
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    if ( connect(fd, (sockaddr *)&addr, sizeof(addr)) != 0 ) return false;
+
+    string request = string("GET ") + path + " HTTP/1.1\r\nHost: localhost\r\nConnection: close\r\n\r\n";
+    send(fd, request.data(), request.size(), 0);
+
+    string response;
+    char buf[1024];
+    ssize_t n;
+    while ( ( n = recv(fd, buf, sizeof(buf), 0) ) > 0 ) response.append(buf, n);
+    close(fd);
+
+    return response.find(string("done ") + path) != string::npos;
+}
+
+int main() {
+    const int num_clients = 10;
+
+    // without a connection the handler runs to completion on its own io_service
+    {
+        DelayedHandler handler;
+        RequestHandler &sync_handler = handler;
+        Request req;
+        req.path_ = "/direct";
+        Response resp;
+        sync_handler.handle(req, resp);
+        if ( resp.content_ != "done /direct" ) {
+            cerr << "direct call failed" << endl;
+            return 1;
+        }
+    }
+
+    // the server listens once constructed, so clients may connect before run() is called
+    Server server("127.0.0.1", "0", 1);
+    server.setHandler(new DelayedHandler());
+    port = server.port();
+
+    boost::thread t([&server] { server.run(); });
+
+    auto start = std::chrono::steady_clock::now();
+
+    std::atomic<int> ok(0);
+    boost::thread_group clients;
+    for( int i = 0 ; i < num_clients ; i++ )
+        clients.create_thread([&ok] { if ( get("/wait") ) ++ok; });
+    clients.join_all();
+
+    auto elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - start).count();
+
+    server.stop();
+    t.join();
+
+    cout << ok << "/" << num_clients << " responses in " << elapsed << "ms" << endl;
+
+    // handlers blocking the thread would need num_clients * 200ms
+    if ( ok != num_clients || elapsed > 1000 ) {
+        cerr << "FAILED" << endl;
+        return 1;
+    }
+
+    return 0;
+}
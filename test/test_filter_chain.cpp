@@ -0,0 +1,92 @@
+#include <wspp/server/filter_chain.hpp>
+#include <wspp/server/request_handler.hpp>
+#include <wspp/server/filters/request_logger.hpp>
+#include <wspp/server/filters/gzip_filter.hpp>
+#include <wspp/util/zstream.hpp>
+
+#include <boost/thread.hpp>
+
+#include <atomic>
+#include <iostream>
+#include <sstream>
+
+using namespace std;
+using namespace wspp::server;
+using namespace wspp::util;
+
+// Runs many requests concurrently through a single FilterChain and checks that every request passed
+// through each filter exactly once and reached the end point.
+
+class NullLogger: public Logger {
+public:
+    NullLogger() {
+        addAppender(std::make_shared<LogStreamAppender>(Info, make_shared<LogSimpleFormatter>(), strm_));
+    }
+
+    ostringstream strm_;
+};
+
+class EchoHandler: public RequestHandler {
+public:
+    void handle(const Request &req, Response &resp) override {
+        string content;
+        while ( content.size() < 1000 ) content += req.path_;
+        resp.write(content, "text/plain");
+    }
+};
+
+// counts the number of times it has been visited by the same request
+class CountingFilter: public Filter {
+public:
+    void handle(Request &req, Response &resp, FilterChain &chain) override {
+        req.SERVER_["VISITS"] += 'x';
+        chain.next(req, resp);
+    }
+};
+
+static const int num_threads = 8;
+static const int num_requests = 10000;
+
+int main() {
+    NullLogger logger;
+    FilterChain chain;
+
+    chain.add(new RequestLoggerFilter(logger));
+    chain.add(new GZipFilter());
+    chain.add(new CountingFilter());
+    chain.setEndPoint(new EchoHandler());
+
+    std::atomic<int> failures(0);
+
+    boost::thread_group threads;
+    for( int t=0 ; t<num_threads ; t++ ) {
+        threads.create_thread([&, t]() {
+            for( int i=0 ; i<num_requests ; i++ ) {
+                Request req;
+                Response resp;
+                req.method_ = "GET";
+                req.path_ = "/thread/" + to_string(t) + "/request/" + to_string(i) + "/";
+                req.SERVER_.add("Accept-Encoding", "gzip, deflate");
+
+                chain.handle(req, resp);
+
+                string expected;
+                while ( expected.size() < 1000 ) expected += req.path_;
+
+                istringstream compressed(resp.content_);
+                izstream strm(compressed);
+                string content((istreambuf_iterator<char>(strm)), istreambuf_iterator<char>());
+
+                if ( req.SERVER_.get("VISITS") != "x" ||
+                     resp.headers_.get("Content-Encoding") != "gzip" ||
+                     content != expected ) ++failures;
+            }
+        });
+    }
+
+    threads.join_all();
+
+    cout << num_threads * num_requests << " requests, " << failures << " failures" << endl;
+
+    return failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,154 @@
+#include <wspp/server/memory_session_handler.hpp>
+#include <wspp/server/session.hpp>
+#include <wspp/database/connection.hpp>
+#include <wspp/database/query.hpp>
+#include <wspp/database/query_result.hpp>
+
+#include <boost/filesystem.hpp>
+#include <boost/thread.hpp>
+
+#include <chrono>
+#include <iostream>
+
+using namespace std;
+using namespace wspp::server;
+using namespace wspp::util;
+
+namespace fs = boost::filesystem;
+
+// Checks that MemorySessionHandler serves sessions from memory, writes back only changed sessions, keeps the changes
+// of evicted sessions until they are written, expires sessions and flushes when destroyed.
+
+// forwards to a handler counting the sessions written
+class CountingHandler: public SessionHandler {
+public:
+    CountingHandler(SessionHandler &handler): handler_(handler) {}
+
+    bool open() override { return handler_.open(); }
+    bool close() override { return handler_.close(); }
+    bool write(const Session &session) override { ++writes_; return handler_.write(session); }
+    bool read(Session &session) override { return handler_.read(session); }
+    string uniqueSID() override { return handler_.uniqueSID(); }
+
+    SessionHandler &handler_;
+    int writes_ = 0;
+};
+
+static int failures = 0;
+
+static void check(bool ok, const char *what) {
+    cout << ( ok ? "ok: " : "FAILED: " ) << what << endl;
+    if ( !ok ) failures++;
+}
+
+// sessions stored in the database
+static int stored_sessions(const string &db_file) {
+    wspp::db::Connection con("sqlite:db=" + db_file);
+    wspp::db::Query q(con, "SELECT count(*) FROM sessions");
+    wspp::db::QueryResult res = q.exec();
+    return res.next() ? res.get<int>(0) : -1;
+}
+
+// start a new session with the given data and return its id
+static string create(SessionHandler &handler, const string &key, const string &value) {
+    Request req;
+    Response resp;
+    Session session(handler, req, resp);
+    session.data()[key] = value;
+    return session.id();
+}
+
+static string value(SessionHandler &handler, const string &sid, const string &key) {
+    Request req;
+    Response resp;
+    req.COOKIE_["WSX_SESSION_ID"] = sid;
+    Session session(handler, req, resp);
+    return session.data().get(key);
+}
+
+int main() {
+    const string db_file = (fs::temp_directory_path() / fs::unique_path("wspp-sessions-%%%%-%%%%.sqlite")).native();
+    const auto never = std::chrono::hours(1);
+
+    {
+        MemorySessionHandler handler(db_file, 64 * 1024 * 1024, std::chrono::minutes(60), never);
+
+        string sid = create(handler, "user", "alice");
+        check(value(handler, sid, "user") == "alice" && stored_sessions(db_file) == 0, "sessions are read from memory");
+
+        handler.flush();
+        check(stored_sessions(db_file) == 1, "changed sessions are written by flush");
+
+        MemorySessionHandler other(db_file, 64 * 1024 * 1024, std::chrono::minutes(60), never);
+        check(value(other, sid, "user") == "alice", "flushed sessions are read from the database");
+    }
+
+    {
+        MemorySessionHandler handler(db_file, 64 * 1024 * 1024, std::chrono::minutes(60), never);
+        CountingHandler counter(handler);
+
+        string sid = create(counter, "user", "alice");
+        for( int i = 0 ; i < 10 ; i++ ) value(counter, sid, "user");
+        check(counter.writes_ == 1, "unchanged sessions are not written");
+    }
+
+    {
+        // room for about a session per shard
+        MemorySessionHandler handler(db_file, 16 * 400, std::chrono::minutes(60), never);
+
+        string sid = create(handler, "user", "bob");
+        for( int i = 0 ; i < 200 ; i++ ) create(handler, "n", to_string(i));
+
+        check(handler.size() < 200 && handler.memory() <= 16 * 400, "sessions are evicted beyond the memory budget");
+        check(value(handler, sid, "user") == "bob", "evicted sessions keep their changes until written");
+
+        for( int i = 0 ; i < 200 ; i++ ) create(handler, "n", to_string(i));
+        handler.flush();
+
+        MemorySessionHandler other(db_file, 64 * 1024 * 1024, std::chrono::minutes(60), never);
+        check(value(other, sid, "user") == "bob", "changes of evicted sessions are flushed");
+    }
+
+    {
+        MemorySessionHandler handler(db_file, 64 * 1024 * 1024, std::chrono::seconds(1), never);
+
+        string sid = create(handler, "user", "carol");
+        handler.flush();
+        boost::this_thread::sleep_for(boost::chrono::milliseconds(1500));
+        handler.expire();
+
+        check(handler.size() == 0 && stored_sessions(db_file) == 0, "sessions not used for the ttl expire");
+        check(value(handler, sid, "user").empty(), "expired sessions are not read");
+    }
+
+    {
+        string sid;
+        auto start = std::chrono::steady_clock::now();
+
+        // a flush every millisecond, so that handlers are destroyed when their timer has just expired (this used to hang)
+        for( int i = 0 ; i < 50 ; i++ ) {
+            MemorySessionHandler handler(db_file, 64 * 1024 * 1024, std::chrono::minutes(60), std::chrono::milliseconds(1));
+            sid = create(handler, "user", "dave" + to_string(i));
+            boost::this_thread::sleep_for(boost::chrono::microseconds(900 + 10 * i));
+        }
+
+        double secs = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        check(secs < 10, "handlers are destroyed while flushing in the background");
+
+        {
+            MemorySessionHandler handler(db_file, 64 * 1024 * 1024, std::chrono::minutes(60), never);
+            sid = create(handler, "user", "erin");
+        }
+
+        MemorySessionHandler handler(db_file, 64 * 1024 * 1024, std::chrono::minutes(60), never);
+        check(value(handler, sid, "user") == "erin", "pending changes are written when the handler is destroyed");
+    }
+
+    boost::system::error_code ec;
+    for( const char *suffix: { "", "-wal", "-shm" } )
+        fs::remove(db_file + suffix, ec);
+
+    cout << failures << " failures" << endl;
+
+    return failures == 0 ? 0 : 1;
+}